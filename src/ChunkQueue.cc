@@ -0,0 +1,107 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <unistd.h>
+#include "ChunkQueue.h"
+
+namespace objctags {
+
+namespace {
+
+// How long the writer sleeps when it finds the queue empty, in microseconds.
+const useconds_t idleInterval = 1000;
+
+} // end namespace
+
+ChunkQueue::ChunkQueue() :
+  _head(NULL),
+  _closed(0)
+{
+}
+
+ChunkQueue::~ChunkQueue()
+{
+  Node *node = _head;
+  while (node != NULL) {
+    Node *next = node->next;
+    delete node;
+    node = next;
+  }
+}
+
+void ChunkQueue::push(std::string &chunk)
+{
+  Node *node = new Node;
+  node->chunk.swap(chunk);
+
+  Node *head;
+  do {
+    head = _head;
+    node->next = head;
+  } while (!__sync_bool_compare_and_swap(&_head, head, node));
+}
+
+void ChunkQueue::close()
+{
+  __sync_lock_test_and_set(&_closed, 1);
+}
+
+bool ChunkQueue::popAll(std::vector<std::string> &chunks)
+{
+  Node *head;
+  while (true) {
+    // Read the flag before detaching, so that nothing pushed before
+    // close() can be missed.
+    bool closed = __sync_fetch_and_add(&_closed, 0) != 0;
+    head = __sync_lock_test_and_set(&_head, static_cast<Node *>(NULL));
+    if (head != NULL) {
+      break;
+    }
+    if (closed) {
+      return false;
+    }
+    usleep(idleInterval);
+  }
+
+  // The detached list is in LIFO order.
+  Node *reversed = NULL;
+  while (head != NULL) {
+    Node *next = head->next;
+    head->next = reversed;
+    reversed = head;
+    head = next;
+  }
+
+  while (reversed != NULL) {
+    Node *next = reversed->next;
+    chunks.push_back(std::string());
+    chunks.back().swap(reversed->chunk);
+    delete reversed;
+    reversed = next;
+  }
+
+  return true;
+}
+
+} // end namespace objctags
@@ -0,0 +1,66 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_ChunkQueue_h__
+#define __objctags_ChunkQueue_h__
+
+#include <string>
+#include <vector>
+
+namespace objctags {
+
+/*
+ * A lock-free multiple-producer, single-consumer queue of formatted
+ * tag chunks.  Workers push without ever blocking each other; the
+ * writer thread detaches the whole pending list in one atomic swap.
+ */
+class ChunkQueue {
+public:
+  ChunkQueue();
+  ~ChunkQueue();
+
+  // Takes over the contents of chunk, leaving it empty.
+  void push(std::string &chunk);
+  void close();
+
+  // Waits until chunks are available, appending them in push order.
+  // Returns false once the queue is closed and drained.
+  bool popAll(std::vector<std::string> &chunks);
+
+private:
+  struct Node {
+    std::string chunk;
+    Node *next;
+  };
+
+  Node *volatile _head;
+  volatile int _closed;
+
+  ChunkQueue(const ChunkQueue &);
+  ChunkQueue &operator=(const ChunkQueue &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_ChunkQueue_h__ */
@@ -22,20 +22,45 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
-#include <algorithm>
-#include <sstream>
+#include <string.h>
+#include <map>
+#include <llvm/Support/MemoryBuffer.h>
 #include <clang/AST/ASTContext.h>
 #include <clang/AST/RecursiveASTVisitor.h>
+#include <clang/Lex/MacroInfo.h>
 #include <clang/Lex/Preprocessor.h>
+#include <clang/Lex/PPCallbacks.h>
 #include "ClangFrontendAction.h"
+#include "Configuration.h"
 
 namespace objctags {
 
 namespace {
 
+void getLine(LineTableMap &lineTables, clang::SourceManager &sourceManager, clang::SourceLocation loc,
+             const char *&line, size_t &lineLength)
+{
+  std::pair<clang::FileID, unsigned> decomposedLoc = sourceManager.getDecomposedLoc(loc);
+  LineTable &lineTable = lineTables[decomposedLoc.first];
+  if (!lineTable.isAssigned()) {
+    const llvm::MemoryBuffer *buffer = sourceManager.getBuffer(decomposedLoc.first);
+    lineTable.assign(buffer->getBufferStart(), buffer->getBufferEnd());
+  }
+  lineTable.getLine(decomposedLoc.second, line, lineLength);
+}
+
 class RecursiveASTVisitor : public clang::RecursiveASTVisitor<RecursiveASTVisitor> {
 public:
-  RecursiveASTVisitor(TagInfoVector *tagInfoVector, clang::ASTContext *context);
+  RecursiveASTVisitor(TagInfoVector *tagInfoVector, LineTableMap *lineTables, clang::ASTContext *context);
+
+  // Tags only depend on declarations and how they nest, so bodies,
+  // initializers, default arguments and types are never walked.  Most
+  // bodies are not even parsed, since ClangTool skips them, so leaving
+  // out the local types of the few that are, e.g. of constexpr
+  // functions, keeps the tags the same whichever clang skipped.
+  bool TraverseStmt(clang::Stmt *stmt) { return true; }
+  bool TraverseType(clang::QualType type) { return true; }
+  bool TraverseTypeLoc(clang::TypeLoc typeLoc) { return true; }
 
   bool VisitTypedefDecl(clang::TypedefDecl *decl);
   //bool VisitTypeAliasDecl(clang::TypeAliasDecl *decl);
@@ -75,9 +100,13 @@ public:
 private:
   clang::ASTContext *_context;
   TagInfoVector *_tagInfoVector;
+  LineTableMap *_lineTables;
+  std::map<const clang::DeclContext *, std::string> _scopes;
+  std::map<const clang::DeclContext *, std::string> _qualifiedNames;
 
   bool _isMain(clang::Decl *decl);
-  std::string _getScope(clang::DeclContext *declContext);
+  const std::string &_getScope(clang::DeclContext *declContext);
+  const std::string &_getQualifiedName(clang::DeclContext *declContext);
   std::string _getPrettyFunctionName(clang::FunctionDecl *decl);
   std::string _getPrettyCategoryName(clang::ObjCContainerDecl *decl);
   std::string _getRealName(clang::NamedDecl *decl);
@@ -86,15 +115,99 @@ private:
 
 class ASTConsumer : public clang::ASTConsumer {
 public:
-  ASTConsumer(TagInfoVector *tagInfoVector, clang::ASTContext *context);
+  ASTConsumer(TagInfoVector *tagInfoVector, LineTableMap *lineTables, clang::ASTContext *context,
+              ParseGuard *guard);
+  virtual bool HandleTopLevelDecl(clang::DeclGroupRef group);
+  virtual void HandleTopLevelDeclInObjCContainer(clang::DeclGroupRef group);
+  virtual void HandleTagDeclDefinition(clang::TagDecl *decl);
   virtual void HandleTranslationUnit(clang::ASTContext &context);
 
 private:
   RecursiveASTVisitor _visitor;
+  ParseGuard *_guard;
+};
+
+class PPCallbacks : public clang::PPCallbacks {
+public:
+  PPCallbacks(TagInfoVector *tagInfoVector,
+              LineTableMap *lineTables,
+              std::set<std::string> *dependencies,
+              clang::SourceManager *sourceManager);
+
+  virtual void FileChanged(clang::SourceLocation loc,
+                           FileChangeReason reason,
+                           clang::SrcMgr::CharacteristicKind fileType,
+                           clang::FileID prevFID);
+  virtual void MacroDefined(const clang::Token &macroNameTok,
+                            const clang::MacroInfo *macroInfo);
+
+private:
+  TagInfoVector *_tagInfoVector;
+  LineTableMap *_lineTables;
+  std::set<std::string> *_dependencies;
+  clang::SourceManager *_sourceManager;
 };
 
 } // end namespace
 
+/*
+ * Checks the budget of a file while it is parsed.  Only the consumer asks,
+ * and only between top-level declarations can it stop the parse, which
+ * clang::ParseAST() does when HandleTopLevelDecl() returns false.
+ */
+class ParseGuard {
+public:
+  explicit ParseGuard(ParseBudget *budget);
+
+  void setContext(clang::ASTContext *context) { _context = context; }
+
+  // Returns false once the budget is exceeded.
+  bool check();
+  bool isExceeded() const { return _budget->exceeded != parselimit_none; }
+
+private:
+  ParseBudget *_budget;
+  double _startTime;
+  double _lastMemoryCheck;
+  clang::ASTContext *_context;
+
+  ParseGuard(const ParseGuard &);
+  ParseGuard &operator=(const ParseGuard &);
+};
+
+ParseGuard::ParseGuard(ParseBudget *budget) :
+  _budget(budget),
+  _startTime(currentTime()),
+  _lastMemoryCheck(0),
+  _context(NULL)
+{
+}
+
+bool ParseGuard::check()
+{
+  if (_budget->exceeded != parselimit_none) {
+    return false;
+  }
+
+  double now = currentTime();
+  if (_budget->seconds > 0 && now - _startTime > _budget->seconds) {
+    _budget->exceeded = parselimit_time;
+    return false;
+  }
+
+  // Summing up the allocator slabs is not free, so it is done at most
+  // every 10ms.
+  if (_budget->memoryBytes > 0 && _context != NULL && now - _lastMemoryCheck >= 0.01) {
+    _lastMemoryCheck = now;
+    size_t memory = _context->getASTAllocatedMemory() + _context->getSideTableAllocatedMemory();
+    if (memory > _budget->memoryBytes) {
+      _budget->exceeded = parselimit_memory;
+      return false;
+    }
+  }
+  return true;
+}
+
 bool RecursiveASTVisitor::_isMain(clang::Decl *decl)
 {
   clang::FullSourceLoc fullLoc = _context->getFullLoc(decl->getLocStart());
@@ -104,93 +217,107 @@ bool RecursiveASTVisitor::_isMain(clang::Decl *decl)
   return true;
 }
 
-std::string RecursiveASTVisitor::_getScope(clang::DeclContext *declContext)
+// Scopes are computed once per DeclContext, each from the cached
+// qualified name of its context.
+const std::string &RecursiveASTVisitor::_getScope(clang::DeclContext *declContext)
 {
+  std::map<const clang::DeclContext *, std::string>::iterator it = _scopes.find(declContext);
+  if (it != _scopes.end()) {
+    return it->second;
+  }
+  std::string &scope = _scopes[declContext];
+
   if (declContext != NULL && declContext->getDeclKind() == clang::Decl::LinkageSpec) {
     declContext = declContext->getParent();
   }
   if (declContext == NULL || declContext->getDeclKind() == clang::Decl::TranslationUnit) {
-    return tagextra_filescope;
+    scope = tagextra_filescope;
+    return scope;
   }
 
-  std::string scopedTypeName;
   switch (declContext->getDeclKind()) {
   case clang::Decl::Namespace:
-    scopedTypeName = getTagKindScopedName(tagkind_namespace);
+    scope = getTagKindScopedName(tagkind_namespace);
     break;
   case clang::Decl::Enum:
-    scopedTypeName = getTagKindScopedName(tagkind_enum);
+    scope = getTagKindScopedName(tagkind_enum);
     break;
   case clang::Decl::ObjCInterface:
-    scopedTypeName = getTagKindScopedName(tagkind_interface);
+    scope = getTagKindScopedName(tagkind_interface);
     break;
   case clang::Decl::ObjCImplementation:
-    scopedTypeName = getTagKindScopedName(tagkind_implementation);
+    scope = getTagKindScopedName(tagkind_implementation);
     break;
   case clang::Decl::ObjCCategory:
-    scopedTypeName = getTagKindScopedName(tagkind_category);
+    scope = getTagKindScopedName(tagkind_category);
     break;
   case clang::Decl::ObjCCategoryImpl:
-    scopedTypeName = getTagKindScopedName(tagkind_category_impl);
+    scope = getTagKindScopedName(tagkind_category_impl);
     break;
   case clang::Decl::ObjCProtocol:
-    scopedTypeName = getTagKindScopedName(tagkind_protocol);
+    scope = getTagKindScopedName(tagkind_protocol);
     break;
   case clang::Decl::Record:
   case clang::Decl::CXXRecord:
     switch (llvm::dyn_cast<clang::TagDecl>(declContext)->getTagKind()) {
     case clang::TTK_Class:
-      scopedTypeName = getTagKindScopedName(tagkind_class);
+      scope = getTagKindScopedName(tagkind_class);
       break;
     case clang::TTK_Struct:
-      scopedTypeName = getTagKindScopedName(tagkind_struct);
+      scope = getTagKindScopedName(tagkind_struct);
       break;
     case clang::TTK_Union:
-      scopedTypeName = getTagKindScopedName(tagkind_union);
+      scope = getTagKindScopedName(tagkind_union);
       break;
     default:
-      return "";
+      return scope;
     }
     break;
   default:
-    return "";
+    return scope;
   }
 
-  std::ostringstream os;
-  os << scopedTypeName << ":";
+  scope += ":";
+  scope += _getQualifiedName(declContext);
+  return scope;
+}
 
-  std::vector<std::string> names;
-  do {
-    clang::NamedDecl *namedDecl = llvm::dyn_cast<clang::NamedDecl>(declContext);
+// The names of declContext and of its named parents, outermost first.
+const std::string &RecursiveASTVisitor::_getQualifiedName(clang::DeclContext *declContext)
+{
+  std::map<const clang::DeclContext *, std::string>::iterator it = _qualifiedNames.find(declContext);
+  if (it != _qualifiedNames.end()) {
+    return it->second;
+  }
 
-    std::string name;
-    if (namedDecl->getKind() == clang::Decl::ObjCCategory ||
-        namedDecl->getKind() == clang::Decl::ObjCCategoryImpl) {
-      name = _getPrettyCategoryName(llvm::dyn_cast<clang::ObjCContainerDecl>(namedDecl));
-    }
-    else {
-      name = namedDecl->getNameAsString();
-    }
+  clang::NamedDecl *namedDecl = llvm::dyn_cast<clang::NamedDecl>(declContext);
+  std::string name;
+  if (namedDecl->getKind() == clang::Decl::ObjCCategory ||
+      namedDecl->getKind() == clang::Decl::ObjCCategoryImpl) {
+    name = _getPrettyCategoryName(llvm::dyn_cast<clang::ObjCContainerDecl>(namedDecl));
+  }
+  else {
+    name = namedDecl->getNameAsString();
+  }
 
+  if (name.length() == 0) {
+    name = _getRealName(namedDecl);
     if (name.length() == 0) {
-      name = _getRealName(namedDecl);
-      if (name.length() == 0) {
-        name = "<Anonymous>";
-      }
+      name = "<Anonymous>";
     }
+  }
 
-    names.push_back(name);
-  } while ((declContext = declContext->getParent()) != NULL &&
-           llvm::isa<clang::NamedDecl>(declContext));
-
-  for (ssize_t i = names.size() - 1; i >= 0; i--) {
-    os << names[i];
-    if (i > 0) {
-      os << tagscope_splitter;
-    }
+  std::string qualifiedName;
+  clang::DeclContext *parent = declContext->getParent();
+  if (parent != NULL && llvm::isa<clang::NamedDecl>(parent)) {
+    qualifiedName = _getQualifiedName(parent);
+    qualifiedName += tagscope_splitter;
   }
+  qualifiedName += name;
 
-  return os.str();
+  std::string &result = _qualifiedNames[declContext];
+  result.swap(qualifiedName);
+  return result;
 }
 
 std::string RecursiveASTVisitor::_getPrettyFunctionName(clang::FunctionDecl *decl)
@@ -239,21 +366,24 @@ std::string RecursiveASTVisitor::_getRealName(clang::NamedDecl *decl)
   return "";
 }
 
+// Plain identifiers, by far the most common names, are passed on as clang
+// keeps them; only the names that have to be built are copied.
 void RecursiveASTVisitor::_addTag(clang::NamedDecl *decl, char kind, const std::string &scope)
 {
-  std::string name;
+  std::string builtName;
+  llvm::StringRef name;
   if (decl->getKind() == clang::Decl::ObjCMethod) {
     if (llvm::dyn_cast<clang::ObjCMethodDecl>(decl)->isClassMethod()) {
-      name = "+" + decl->getNameAsString();
+      builtName = "+" + decl->getNameAsString();
     }
     else {
-      name = "-" + decl->getNameAsString();
+      builtName = "-" + decl->getNameAsString();
     }
   }
   else if (decl->getKind() == clang::Decl::ObjCCategory ||
            decl->getKind() == clang::Decl::ObjCCategoryImpl) {
-    name = _getPrettyCategoryName(llvm::dyn_cast<clang::ObjCContainerDecl>(decl));
-    if (name.length() == 0) {
+    builtName = _getPrettyCategoryName(llvm::dyn_cast<clang::ObjCContainerDecl>(decl));
+    if (builtName.length() == 0) {
       return;
     }
   }
@@ -262,46 +392,45 @@ void RecursiveASTVisitor::_addTag(clang::NamedDecl *decl, char kind, const std::
     //if (!function->hasBody()) {
     //  kind = tagkind_prototype;
     //}
-    name = _getPrettyFunctionName(function);
+    builtName = _getPrettyFunctionName(function);
   }
   else if (decl->getKind() == clang::Decl::NamespaceAlias) {
-    name = decl->getNameAsString() + llvm::dyn_cast<clang::NamespaceAliasDecl>(decl)->getAliasedNamespace()->getNameAsString();
+    builtName = decl->getNameAsString() + llvm::dyn_cast<clang::NamespaceAliasDecl>(decl)->getAliasedNamespace()->getNameAsString();
+  }
+  else if (clang::IdentifierInfo *identifier = decl->getIdentifier()) {
+    name = identifier->getName();
   }
   else {
-    name = decl->getNameAsString();
-    if (name.length() == 0) {
-      name = _getRealName(decl);
-      if (name.length() == 0) {
+    builtName = decl->getNameAsString();
+    if (builtName.length() == 0) {
+      builtName = _getRealName(decl);
+      if (builtName.length() == 0) {
         return;
       }
     }
   }
-
-  clang::FullSourceLoc fullLoc = _context->getFullLoc(decl->getLocStart());
-  clang::SourceLocation spellingLoc = _context->getSourceManager().getSpellingLoc(fullLoc);
-  llvm::StringRef fileNameRef = _context->getSourceManager().getFilename(spellingLoc);
-
-  unsigned spellingColumnNumber = fullLoc.getSpellingColumnNumber();
-  const char *beginOfLine = fullLoc.getCharacterData() - spellingColumnNumber + 1;
-  const char *endOfLine = beginOfLine;
-  while (*endOfLine != '\r' && *endOfLine != '\n' && *endOfLine != '\0') {
-    endOfLine++;
+  if (name.empty()) {
+    name = builtName;
   }
-  std::string line(beginOfLine, static_cast<size_t>(endOfLine - beginOfLine));
 
-  TagInfo tagInfo;
-  tagInfo.name = name;
-  tagInfo.file = fileNameRef.str();
-  tagInfo.line = line;
-  tagInfo.kind = kind;
-  tagInfo.scope = scope;
+  clang::SourceManager &sourceManager = _context->getSourceManager();
+  clang::SourceLocation spellingLoc = sourceManager.getSpellingLoc(decl->getLocStart());
+  const char *line;
+  size_t lineLength;
+  getLine(*_lineTables, sourceManager, spellingLoc, line, lineLength);
 
-  _tagInfoVector->push_back(tagInfo);
+  llvm::StringRef file = sourceManager.getFilename(spellingLoc);
+  _tagInfoVector->add(name.data(), name.size(),
+                      file.data(), file.size(),
+                      line, lineLength,
+                      kind, scope.data(), scope.size());
 }
 
-RecursiveASTVisitor::RecursiveASTVisitor(TagInfoVector *tagInfoVector, clang::ASTContext *context) :
+RecursiveASTVisitor::RecursiveASTVisitor(TagInfoVector *tagInfoVector, LineTableMap *lineTables,
+                                         clang::ASTContext *context) :
   _context(context),
-  _tagInfoVector(tagInfoVector)
+  _tagInfoVector(tagInfoVector),
+  _lineTables(lineTables)
 {
 }
 
@@ -466,71 +595,147 @@ bool RecursiveASTVisitor::VisitObjCPropertyDecl(clang::ObjCPropertyDecl *decl)
   return true;
 }
 
-ASTConsumer::ASTConsumer(TagInfoVector *tagInfoVector, clang::ASTContext *context) :
-  _visitor(tagInfoVector, context)
+ASTConsumer::ASTConsumer(TagInfoVector *tagInfoVector, LineTableMap *lineTables, clang::ASTContext *context,
+                         ParseGuard *guard) :
+  _visitor(tagInfoVector, lineTables, context),
+  _guard(guard)
 {
 }
 
-void ASTConsumer::HandleTranslationUnit(clang::ASTContext &context)
+// Returning false makes clang::ParseAST() give up on the file.
+bool ASTConsumer::HandleTopLevelDecl(clang::DeclGroupRef group)
 {
-  _visitor.TraverseDecl(context.getTranslationUnitDecl());
+  return _guard == NULL || _guard->check();
 }
 
-void ClangFrontendAction::EndSourceFileAction()
+// These come in the middle of an @implementation or of a nested
+// definition.  They cannot stop the parse, but once the budget is found
+// exceeded there, the next top-level declaration does.
+void ASTConsumer::HandleTopLevelDeclInObjCContainer(clang::DeclGroupRef group)
 {
-  clang::ASTFrontendAction::EndSourceFileAction();
+  if (_guard != NULL) {
+    _guard->check();
+  }
+}
+
+void ASTConsumer::HandleTagDeclDefinition(clang::TagDecl *decl)
+{
+  if (_guard != NULL) {
+    _guard->check();
+  }
+}
 
-  clang::CompilerInstance &compiler = getCompilerInstance();
-  clang::ASTContext &context = compiler.getASTContext();
-  clang::SourceManager &sourceManager = compiler.getSourceManager();
-  clang::Preprocessor &pp = compiler.getPreprocessor();
-  clang::Preprocessor::macro_iterator it;
-  std::vector<TagInfo> macroTags;
+// Nearly all top-level declarations come from headers, and would be
+// thrown away by _isMain() one by one, so only those that start in the
+// main file are traversed at all.  Going through noload_decls also keeps
+// the declarations of the precompiled prefix from being deserialized.
+void ASTConsumer::HandleTranslationUnit(clang::ASTContext &context)
+{
+  // The tags of a file that ran out of budget are thrown away.
+  if (_guard != NULL && _guard->isExceeded()) {
+    return;
+  }
 
-  for (it = pp.macro_begin(); it != pp.macro_end(); it++) {
-    if (it->second->isBuiltinMacro() || it->second->isFromAST()) {
-      continue;
-    }
+  clang::SourceManager &sourceManager = context.getSourceManager();
+  clang::FileID mainFileID = sourceManager.getMainFileID();
+  clang::TranslationUnitDecl *unit = context.getTranslationUnitDecl();
 
-    clang::FullSourceLoc fullLoc = context.getFullLoc(it->second->getDefinitionLoc());
-    if (fullLoc.isInvalid() || fullLoc.getFileID() != sourceManager.getMainFileID()) {
-      continue;
+  for (clang::DeclContext::decl_iterator it = unit->noload_decls_begin(); it != unit->noload_decls_end(); it++) {
+    clang::SourceLocation loc = (*it)->getLocStart();
+    if (loc.isValid() && sourceManager.getFileID(sourceManager.getExpansionLoc(loc)) == mainFileID) {
+      _visitor.TraverseDecl(*it);
     }
+  }
+}
 
-    clang::SourceLocation spellingLoc = sourceManager.getSpellingLoc(fullLoc);
-    llvm::StringRef fileNameRef = sourceManager.getFilename(spellingLoc);
+PPCallbacks::PPCallbacks(TagInfoVector *tagInfoVector,
+                         LineTableMap *lineTables,
+                         std::set<std::string> *dependencies,
+                         clang::SourceManager *sourceManager) :
+  _tagInfoVector(tagInfoVector),
+  _lineTables(lineTables),
+  _dependencies(dependencies),
+  _sourceManager(sourceManager)
+{
+}
 
-    unsigned spellingColumnNumber = fullLoc.getSpellingColumnNumber();
-    const char *beginOfLine = fullLoc.getCharacterData() - spellingColumnNumber + 1;
-    const char *endOfLine = beginOfLine;
-    while (*endOfLine != '\r' && *endOfLine != '\n' && *endOfLine != '\0') {
-      endOfLine++;
-    }
-    std::string line(beginOfLine, static_cast<size_t>(endOfLine - beginOfLine));
+void PPCallbacks::FileChanged(clang::SourceLocation loc,
+                              FileChangeReason reason,
+                              clang::SrcMgr::CharacteristicKind fileType,
+                              clang::FileID prevFID)
+{
+  if (_dependencies == NULL || reason != EnterFile || fileType != clang::SrcMgr::C_User) {
+    return;
+  }
 
-    TagInfo tagInfo;
-    tagInfo.name = it->first->getName().str();
-    tagInfo.file = fileNameRef.str();
-    tagInfo.line = line;
-    tagInfo.kind = tagkind_define;
-    tagInfo.scope = tagextra_filescope;
+  clang::FileID fileID = _sourceManager->getFileID(_sourceManager->getExpansionLoc(loc));
+  if (fileID == _sourceManager->getMainFileID()) {
+    return;
+  }
+
+  const clang::FileEntry *fileEntry = _sourceManager->getFileEntryForID(fileID);
+  if (fileEntry != NULL) {
+    _dependencies->insert(fileEntry->getName());
+  }
+}
 
-    macroTags.push_back(tagInfo);
+// Macros are tagged as they are defined, which happens before any
+// declaration is visited, so they still come first.
+void PPCallbacks::MacroDefined(const clang::Token &macroNameTok,
+                               const clang::MacroInfo *macroInfo)
+{
+  clang::SourceLocation loc = macroInfo->getDefinitionLoc();
+  if (loc.isInvalid() || !loc.isFileID() || _sourceManager->getFileID(loc) != _sourceManager->getMainFileID()) {
+    return;
   }
 
-  _tagInfoVector->insert(_tagInfoVector->begin(), macroTags.begin(), macroTags.end());
-  _tagInfoVector->resize(std::distance(_tagInfoVector->begin(), std::unique(_tagInfoVector->begin(), _tagInfoVector->end())));
+  const char *line;
+  size_t lineLength;
+  getLine(*_lineTables, *_sourceManager, loc, line, lineLength);
+
+  llvm::StringRef name = macroNameTok.getIdentifierInfo()->getName();
+  llvm::StringRef file = _sourceManager->getFilename(loc);
+  _tagInfoVector->add(name.data(), name.size(),
+                      file.data(), file.size(),
+                      line, lineLength,
+                      tagkind_define, tagextra_filescope, strlen(tagextra_filescope));
 }
 
-ClangFrontendAction::ClangFrontendAction(TagInfoVector &tagInfoVector) :
-  _tagInfoVector(&tagInfoVector)
+bool ClangFrontendAction::BeginSourceFileAction(clang::CompilerInstance &compiler,
+                                                llvm::StringRef file)
 {
+  compiler.getPreprocessor().addPPCallbacks(new PPCallbacks(_tagInfoVector, &_lineTables, _dependencies,
+                                                            &compiler.getSourceManager()));
+  return clang::ASTFrontendAction::BeginSourceFileAction(compiler, file);
+}
+
+void ClangFrontendAction::EndSourceFileAction()
+{
+  clang::ASTFrontendAction::EndSourceFileAction();
+  _lineTables.clear();
+}
+
+ClangFrontendAction::ClangFrontendAction(TagInfoVector &tagInfoVector,
+                                         std::set<std::string> *dependencies,
+                                         ParseBudget *budget) :
+  _tagInfoVector(&tagInfoVector),
+  _dependencies(dependencies),
+  _guard(budget != NULL ? new ParseGuard(budget) : NULL)
+{
+}
+
+ClangFrontendAction::~ClangFrontendAction()
+{
+  delete _guard;
 }
 
 clang::ASTConsumer *ClangFrontendAction::CreateASTConsumer(clang::CompilerInstance &compiler,
                                       llvm::StringRef file)
 {
-  return new ASTConsumer(_tagInfoVector, &compiler.getASTContext());
+  if (_guard != NULL) {
+    _guard->setContext(&compiler.getASTContext());
+  }
+  return new ASTConsumer(_tagInfoVector, &_lineTables, &compiler.getASTContext(), _guard);
 }
 
 } // end namespace objctags
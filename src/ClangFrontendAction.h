@@ -25,26 +25,80 @@
 #ifndef __objctags_ClangFrontendAction_h__
 #define __objctags_ClangFrontendAction_h__
 
+#include <map>
+#include <set>
+#include <string>
 #include <llvm/ADT/StringRef.h>
+#include <clang/Basic/SourceLocation.h>
 #include <clang/AST/ASTConsumer.h>
 #include <clang/Frontend/FrontendAction.h>
 #include <clang/Frontend/CompilerInstance.h>
+#include "LineTable.h"
 #include "TagInfo.h"
 
 namespace objctags {
 
+enum ParseLimit {
+  parselimit_none,
+  parselimit_time,
+  parselimit_memory
+};
+
+/*
+ * Limits how long one file may be parsed and how much memory its AST may
+ * take.  Only the AST is counted: the resident size of the process is
+ * shared by every worker, so it says nothing about a single file.  The
+ * parse can only be stopped between top-level declarations, so a limit
+ * may be overshot by a single one, e.g. a large @implementation.
+ */
+struct ParseBudget {
+  ParseBudget() : seconds(0), memoryBytes(0), exceeded(parselimit_none) {}
+
+  // Zero means unlimited.
+  double seconds;
+  size_t memoryBytes;
+
+  // The limit that stopped parsing, if any.
+  ParseLimit exceeded;
+};
+
+// Tags are looked up in the line table of the file they are spelled in,
+// built the first time a tag is found there.
+typedef std::map<clang::FileID, LineTable> LineTableMap;
+
+class ParseGuard;
+
 class ClangFrontendAction : public clang::ASTFrontendAction {
 public:
-  explicit ClangFrontendAction(TagInfoVector &tagInfoVector);
+  // If dependencies is given, it receives every non-system file the
+  // main file includes, directly or indirectly.  If budget is given,
+  // parsing stops once it is exceeded, leaving the tags incomplete.
+  explicit ClangFrontendAction(TagInfoVector &tagInfoVector,
+                               std::set<std::string> *dependencies = NULL,
+                               ParseBudget *budget = NULL);
+  virtual ~ClangFrontendAction();
+
+  // Tags only need the declarations as written, so the file is parsed as
+  // a prefix, which skips the function template instantiations clang
+  // would otherwise do at its end.
+  virtual clang::TranslationUnitKind getTranslationUnitKind() { return clang::TU_Prefix; }
 
   virtual clang::ASTConsumer *CreateASTConsumer(clang::CompilerInstance &compiler,
                                                 llvm::StringRef file);
 
 protected:
+  virtual bool BeginSourceFileAction(clang::CompilerInstance &compiler,
+                                     llvm::StringRef file);
   virtual void EndSourceFileAction();
 
 private:
   TagInfoVector *_tagInfoVector;
+  std::set<std::string> *_dependencies;
+  ParseGuard *_guard;
+  LineTableMap _lineTables;
+
+  ClangFrontendAction(const ClangFrontendAction &);
+  ClangFrontendAction &operator=(const ClangFrontendAction &);
 };
 
 } // end namespace objctags
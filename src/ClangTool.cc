@@ -22,6 +22,7 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <sys/stat.h>
 #include <llvm/ADT/SmallString.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/ADT/ArrayRef.h>
@@ -29,6 +30,7 @@
 #include <llvm/ADT/IntrusiveRefCntPtr.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
 #include <clang/Basic/FileManager.h>
 #include <clang/Basic/FileSystemOptions.h>
 #include <clang/Frontend/CompilerInvocation.h>
@@ -38,74 +40,177 @@
 #include <clang/Driver/Driver.h>
 #include <clang/Driver/Tool.h>
 #include "ClangTool.h"
+#include "StatCache.h"
 
 namespace objctags {
 
+namespace {
+
+// The driver is run once per argument list on this made-up file, and
+// the result is patched with the real file name afterwards.
+const char *const placeholderDirectory = "/objctags-placeholder/";
+const char *const placeholderStem = "input";
+
+} // end namespace
+
+ClangTool::ClangTool(StatCacheTable *statCache) :
+  _statCache(statCache),
+  _statCacheGeneration(0)
+{
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> diagnosticOpts(new clang::DiagnosticOptions());
+  _diagnostics = new clang::DiagnosticsEngine(llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs>(new clang::DiagnosticIDs()), &*diagnosticOpts, new clang::IgnoringDiagConsumer(), true);
+  _createFileManager();
+}
+
+ClangTool::~ClangTool()
+{
+}
+
+void ClangTool::_createFileManager()
+{
+  _fileManager = new clang::FileManager((clang::FileSystemOptions()));
+  if (_statCache != NULL) {
+    _statCacheGeneration = _statCache->getGeneration();
+    _fileManager->addStatCache(new SharedStatCache(_statCache));
+  }
+}
+
 // Most of codes here are stolen from 'clang/lib/Tooling/Tooling.cpp',
 // as we shall get rid of those annoying diagnostic messages.
-bool runClangToolOnCodeWithArgs(clang::FrontendAction *action,
-                                const llvm::Twine &code,
-                                const std::vector<std::string> &args,
-                                const llvm::Twine &fileName)
+bool ClangTool::_getCC1Args(const std::vector<std::string> &args,
+                            llvm::StringRef fileName,
+                            std::vector<std::string> &cc1Args)
+{
+  // Without '-x' the driver picks the language from the extension.
+  std::string extension = llvm::sys::path::extension(fileName).str();
+  std::string placeholderName = std::string(placeholderStem) + extension;
+  std::string placeholderPath = std::string(placeholderDirectory) + placeholderName;
+
+  std::vector<std::string> key(args);
+  key.push_back(extension);
+
+  std::map<std::vector<std::string>, std::vector<std::string> >::iterator it = _cc1ArgsCache.find(key);
+  if (it == _cc1ArgsCache.end()) {
+    std::vector<const char *> argv;
+    argv.push_back("clang-tool");
+    argv.push_back("-fsyntax-only");
+    for (size_t i = 0; i < args.size(); i++) {
+      argv.push_back(args[i].c_str());
+    }
+    argv.push_back(placeholderPath.c_str());
+
+    std::vector<std::string> result;
+    const llvm::OwningPtr<clang::driver::Driver> driver(new clang::driver::Driver(argv[0], llvm::sys::getDefaultTargetTriple(), "a.out", false, *_diagnostics));
+    driver->setTitle("clang_based_tool");
+    driver->setCheckInputsExist(false);
+
+    const llvm::OwningPtr<clang::driver::Compilation> compilation(driver->BuildCompilation(llvm::makeArrayRef(argv)));
+    const clang::driver::JobList &jobs = compilation.get()->getJobs();
+    if (jobs.size() == 1 && llvm::isa<clang::driver::Command>(*jobs.begin())) {
+      const clang::driver::Command *cmd = llvm::cast<clang::driver::Command>(*jobs.begin());
+      if (llvm::StringRef(cmd->getCreator().getName()) == "clang") {
+        const clang::driver::ArgStringList &arguments = cmd->getArguments();
+        for (size_t i = 1; i < arguments.size(); i++) {
+          result.push_back(arguments[i]);
+        }
+      }
+    }
+
+    //compilation->PrintJob(llvm::errs(), compilation->getJobs(), "\n", true);
+
+    // An empty list records that the driver failed for these arguments.
+    it = _cc1ArgsCache.insert(std::make_pair(key, result)).first;
+  }
+
+  if (it->second.empty()) {
+    return false;
+  }
+
+  cc1Args = it->second;
+  std::string baseName = llvm::sys::path::filename(fileName).str();
+  for (size_t i = 0; i < cc1Args.size(); i++) {
+    if (cc1Args[i] == placeholderPath) {
+      cc1Args[i] = fileName.str();
+    }
+    else if (cc1Args[i] == placeholderName) {
+      cc1Args[i] = baseName;
+    }
+  }
+
+  return true;
+}
+
+bool ClangTool::run(clang::FrontendAction *action,
+                    llvm::StringRef code,
+                    const std::vector<std::string> &args,
+                    const llvm::Twine &fileName,
+                    const std::string &outputFile)
 {
   llvm::SmallString<16> fileNameStorage;
   llvm::StringRef fileNameRef = fileName.toNullTerminatedStringRef(fileNameStorage);
   llvm::SmallString<1024> pathStorage;
   llvm::sys::path::native(fileNameRef, pathStorage);
-  llvm::SmallString<1024> codeStorage;
-  llvm::StringRef codeRef = code.toNullTerminatedStringRef(codeStorage);
   llvm::OwningPtr<clang::FrontendAction> scopedToolAction(action);
-  clang::FileManager fileManager((clang::FileSystemOptions()));
 
-  std::vector<const char *> argv;
-  argv.push_back("clang-tool");
-  argv.push_back("-fsyntax-only");
-  for (size_t i = 0; i < args.size(); i++) {
-    argv.push_back(args[i].c_str());
+  // Forget the errors of the previous file, and the files it saw if they
+  // may have changed since.
+  _diagnostics->Reset();
+  if (_statCache != NULL && _statCache->getGeneration() != _statCacheGeneration) {
+    _createFileManager();
   }
-  argv.push_back(fileNameRef.data());
-
-  llvm::IntrusiveRefCntPtr<clang::DiagnosticOptions> diagnosticOpts(new clang::DiagnosticOptions());
-  llvm::OwningPtr<clang::DiagnosticsEngine> diagnostics(new clang::DiagnosticsEngine(llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs>(new clang::DiagnosticIDs()), &*diagnosticOpts, new clang::IgnoringDiagConsumer(), true));
-
-  const llvm::OwningPtr<clang::driver::Driver> driver(new clang::driver::Driver(argv[0], llvm::sys::getDefaultTargetTriple(), "a.out", false, *diagnostics.get()));
-  driver->setTitle("clang_based_tool");
-  driver->setCheckInputsExist(false);
 
-  const llvm::OwningPtr<clang::driver::Compilation> compilation(driver->BuildCompilation(llvm::makeArrayRef(argv)));
-  const clang::driver::JobList &jobs = compilation.get()->getJobs();
-  if (jobs.size() != 1 || !llvm::isa<clang::driver::Command>(*jobs.begin())) {
-    return false;
-  }
-  const clang::driver::Command *cmd = llvm::cast<clang::driver::Command>(*jobs.begin());
-  if (llvm::StringRef(cmd->getCreator().getName()) != "clang") {
+  std::vector<std::string> cc1Args;
+  if (!_getCC1Args(args, fileNameRef, cc1Args)) {
     return false;
   }
-  const clang::driver::ArgStringList *const cc1Args = &cmd->getArguments();
 
-  //compilation->PrintJob(llvm::errs(), compilation->getJobs(), "\n", true);
+  std::vector<const char *> cc1Argv;
+  for (size_t i = 0; i < cc1Args.size(); i++) {
+    cc1Argv.push_back(cc1Args[i].c_str());
+  }
 
   llvm::OwningPtr<clang::CompilerInvocation> invocation(new clang::CompilerInvocation());
-  clang::CompilerInvocation::CreateFromArgs(*invocation, cc1Args->data() + 1, cc1Args->data() + cc1Args->size(), *diagnostics.get());
+  clang::CompilerInvocation::CreateFromArgs(*invocation, &cc1Argv[0], &cc1Argv[0] + cc1Argv.size(), *_diagnostics);
   invocation->getFrontendOpts().DisableFree = false;
   invocation->getFrontendOpts().SkipFunctionBodies = true;
+  invocation->getFrontendOpts().OutputFile = outputFile;
   invocation->getDiagnosticOpts().ShowCarets = false;
 
+  // The compiler only takes references, both objects outlive it.
   clang::CompilerInstance compiler;
   compiler.setInvocation(invocation.take());
-  compiler.setDiagnostics(diagnostics.take());
-  compiler.setFileManager(&fileManager);
+  compiler.setDiagnostics(_diagnostics.getPtr());
+  compiler.setFileManager(_fileManager.getPtr());
 
-  compiler.createSourceManager(fileManager);
-  const llvm::MemoryBuffer *input = llvm::MemoryBuffer::getMemBuffer(codeRef);
-  const clang::FileEntry *file = fileManager.getVirtualFile(pathStorage, input->getBufferSize(), 0);
+  compiler.createSourceManager(*_fileManager);
+  // The buffer only refers to code, which outlives the compiler.
+  const llvm::MemoryBuffer *input = llvm::MemoryBuffer::getMemBuffer(code, pathStorage.str());
+
+  // Keep the real modification time, so that a PCH built from this file
+  // still validates when it is loaded by other files.
+  struct stat st;
+  time_t modificationTime = (stat(pathStorage.c_str(), &st) == 0) ? st.st_mtime : 0;
+  const clang::FileEntry *file = _fileManager->getVirtualFile(pathStorage, input->getBufferSize(), modificationTime);
   compiler.getSourceManager().overrideFileContents(file, input);
 
-  const bool success = compiler.ExecuteAction(*scopedToolAction);
-  compiler.resetAndLeakFileManager();
-  fileManager.clearStatCaches();
+  return compiler.ExecuteAction(*scopedToolAction);
+}
+
+bool ClangTool::hasFatalError() const
+{
+  return _diagnostics->hasFatalErrorOccurred();
+}
 
-  return success;
+bool runClangToolOnCodeWithArgs(clang::FrontendAction *action,
+                                const llvm::Twine &code,
+                                const std::vector<std::string> &args,
+                                const llvm::Twine &fileName,
+                                const std::string &outputFile)
+{
+  llvm::SmallString<1024> codeStorage;
+  llvm::StringRef codeRef = code.toNullTerminatedStringRef(codeStorage);
+  ClangTool tool;
+  return tool.run(action, codeRef, args, fileName, outputFile);
 }
 
 } // end namespace objctags
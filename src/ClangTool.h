@@ -25,17 +25,72 @@
 #ifndef __objctags_ClangTool_h__
 #define __objctags_ClangTool_h__
 
+#include <map>
 #include <string>
 #include <vector>
 #include <llvm/ADT/Twine.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/ADT/IntrusiveRefCntPtr.h>
 #include <clang/Frontend/FrontendAction.h>
 
+namespace clang {
+class DiagnosticsEngine;
+class FileManager;
+}
+
 namespace objctags {
 
+class StatCacheTable;
+
+/*
+ * A long-lived compiler context, meant to be owned by one thread.  The
+ * diagnostics engine and the file manager are shared by every file it
+ * runs, and the cc1 arguments computed by the driver are cached per
+ * distinct argument list.  The stat results of header lookups can be
+ * shared with other threads through a StatCacheTable.
+ */
+class ClangTool {
+public:
+  // If statCache is given, header lookups go through it.
+  explicit ClangTool(StatCacheTable *statCache = NULL);
+  ~ClangTool();
+
+  // Takes ownership of action.  code is parsed in place and must be
+  // followed by a null character, as the buffer of an llvm::MemoryBuffer
+  // is.  outputFile is only used by actions that write one, e.g.
+  // clang::GeneratePCHAction.
+  bool run(clang::FrontendAction *action,
+           llvm::StringRef code,
+           const std::vector<std::string> &args,
+           const llvm::Twine &fileName,
+           const std::string &outputFile = std::string());
+
+  // Whether the last file run hit a fatal error, e.g. a missing header,
+  // in which case the rest of it was not parsed.
+  bool hasFatalError() const;
+
+private:
+  llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine> _diagnostics;
+  llvm::IntrusiveRefCntPtr<clang::FileManager> _fileManager;
+  StatCacheTable *_statCache;
+  unsigned long _statCacheGeneration;
+  std::map<std::vector<std::string>, std::vector<std::string> > _cc1ArgsCache;
+
+  void _createFileManager();
+  bool _getCC1Args(const std::vector<std::string> &args,
+                   llvm::StringRef fileName,
+                   std::vector<std::string> &cc1Args);
+
+  ClangTool(const ClangTool &);
+  ClangTool &operator=(const ClangTool &);
+};
+
+// Runs a single file with a throwaway ClangTool.
 bool runClangToolOnCodeWithArgs(clang::FrontendAction *action,
                                 const llvm::Twine &code,
                                 const std::vector<std::string> &args,
-                                const llvm::Twine &fileName);
+                                const llvm::Twine &fileName,
+                                const std::string &outputFile = std::string());
 
 } // end namespace objctags
 
@@ -26,11 +26,18 @@
 #include <utility>
 #include <algorithm>
 #include <fstream>
+#include <ctype.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <wordexp.h>
-#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 #include "Configuration.h"
+#include "DirectoryWalker.h"
 
 namespace objctags {
 
@@ -63,6 +70,16 @@ void Configuration::addDefine(const std::string &key, const std::string &value)
   }
 }
 
+void Configuration::setPrefixHeader(const std::string &prefixHeader)
+{
+  _prefixHeader = prefixHeader;
+}
+
+void Configuration::setPrecompiledHeader(const std::string &precompiledHeader)
+{
+  _precompiledHeader = precompiledHeader;
+}
+
 std::vector<std::string> Configuration::getClangArgs() const
 {
   std::vector<std::string> args;
@@ -76,6 +93,14 @@ std::vector<std::string> Configuration::getClangArgs() const
   }
   args.insert(args.end(), _searchPaths.begin(), _searchPaths.end());
   args.insert(args.end(), _defines.begin(), _defines.end());
+  if (!_precompiledHeader.empty()) {
+    args.push_back("-include-pch");
+    args.push_back(_precompiledHeader);
+  }
+  else if (!_prefixHeader.empty()) {
+    args.push_back("-include");
+    args.push_back(_prefixHeader);
+  }
   return args;
 }
 
@@ -136,46 +161,73 @@ std::string getSourceTypeForFileName(const std::string &fileName)
 
 namespace {
 
-void recursivelySearchSourceFiles(std::vector<std::string> &sourceFiles, const std::string &directory)
+// The keys of sourceTypeMap.
+const char *const sourceExtensions[] = { "c", "cpp", "cc", "m", "mm", "h", "hpp", "inl" };
+
+} // end namespace
+
+bool isSourceFileName(const char *fileName)
 {
-  if (directory.empty()) {
-    return;
+  const char *dot = strrchr(fileName, '.');
+  if (dot == NULL) {
+    return false;
   }
 
-  DIR *dir = opendir(directory.c_str());
-  if (dir == NULL) {
-    return;
+  char extension[4];
+  size_t length = 0;
+  for (const char *p = dot + 1; *p != '\0'; p++) {
+    if (length == sizeof(extension) - 1) {
+      return false;
+    }
+    extension[length++] = static_cast<char>(tolower(static_cast<unsigned char>(*p)));
   }
+  extension[length] = '\0';
 
-  while (true) {
-    struct dirent *ent = readdir(dir);
-    if (ent == NULL) {
-      break;
+  for (size_t i = 0; i < sizeof(sourceExtensions) / sizeof(sourceExtensions[0]); i++) {
+    if (strcmp(extension, sourceExtensions[i]) == 0) {
+      return true;
     }
+  }
+  return false;
+}
 
-    if (ent->d_type & DT_REG) {
-      std::string fullname = directory + "/" + ent->d_name;
-      if (!getSourceTypeForFileName(fullname).empty()) {
-        sourceFiles.push_back(fullname);
-      }
-    }
-    else if (ent->d_type & DT_DIR) {
-      if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
-        std::string childDir = directory + "/" + ent->d_name;
-        recursivelySearchSourceFiles(sourceFiles, childDir);
-      }
-    }
+namespace {
+
+class SourceFileCollector : public DirectoryWalker::Listener {
+public:
+  explicit SourceFileCollector(std::vector<std::string> &sourceFiles) :
+    _sourceFiles(sourceFiles)
+  {
+    pthread_mutex_init(&_mutex, NULL);
   }
 
-  closedir(dir);
-}
+  ~SourceFileCollector()
+  {
+    pthread_mutex_destroy(&_mutex);
+  }
+
+  virtual void foundSourceFile(const std::string &fileName)
+  {
+    pthread_mutex_lock(&_mutex);
+    _sourceFiles.push_back(fileName);
+    pthread_mutex_unlock(&_mutex);
+  }
+
+private:
+  std::vector<std::string> &_sourceFiles;
+  pthread_mutex_t _mutex;
+};
 
 } // end namespace
 
 std::vector<std::string> recursivelySearchSourceFiles(const std::string &directory)
 {
   std::vector<std::string> sourceFiles;
-  recursivelySearchSourceFiles(sourceFiles, directory);
+  SourceFileCollector collector(sourceFiles);
+  DirectoryWalker walker(sysconf(_SC_NPROCESSORS_ONLN));
+  walker.walk(directory, collector);
+  // The walker threads find them in no particular order.
+  std::sort(sourceFiles.begin(), sourceFiles.end());
   return sourceFiles;
 }
 
@@ -192,6 +244,19 @@ std::string expandPath(const std::string &path)
       }
       else {
         result = std::string(we.we_wordv[0]);
+        // A file that does not exist, e.g. one just deleted, is still
+        // named as it was while it did, as long as its directory is there.
+        std::string::size_type slash = result.rfind('/');
+        std::string parent = (slash == std::string::npos) ? "." : result.substr(0, (slash == 0) ? 1 : slash);
+        std::string base = result.substr((slash == std::string::npos) ? 0 : slash + 1);
+        if (!base.empty() && base != "." && base != ".." && (rp = realpath(parent.c_str(), NULL)) != NULL) {
+          result = std::string(rp);
+          free(rp);
+          if (result[result.length() - 1] != '/') {
+            result += '/';
+          }
+          result += base;
+        }
       }
     }
     wordfree(&we);
@@ -201,8 +266,35 @@ std::string expandPath(const std::string &path)
 
 std::string readFile(const std::string &fileName)
 {
-  std::fstream fs(fileName.c_str());
-  return std::string((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+  std::string result;
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return result;
+  }
+
+  // One allocation of the final size, rather than growing as it reads.
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    result.resize(static_cast<size_t>(st.st_size));
+    size_t length = 0;
+    while (length < result.size()) {
+      ssize_t count = read(fd, &result[length], result.size() - length);
+      if (count <= 0) {
+        break;
+      }
+      length += static_cast<size_t>(count);
+    }
+    result.resize(length);
+  }
+  close(fd);
+  return result;
+}
+
+double currentTime()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
 }
 
 } // end namespace objctags
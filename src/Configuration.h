@@ -33,23 +33,37 @@ namespace objctags {
 class Configuration {
 public:
   void setSourceType(const std::string &sourceType);
+  const std::string &getSourceType() const { return _sourceType; }
   void setSysroot(const std::string &sysroot);
   void addSearchPath(const std::string &path);
   void addDefine(const std::string &key, const std::string &value = "");
 
+  // The prefix header is implicitly included by every file, as Xcode does.
+  // When a precompiled version of it is set, that is loaded instead.
+  void setPrefixHeader(const std::string &prefixHeader);
+  void setPrecompiledHeader(const std::string &precompiledHeader);
+  const std::string &getPrefixHeader() const { return _prefixHeader; }
+
   std::vector<std::string> getClangArgs() const;
 
 private:
   std::string _sourceType;
   std::string _sysroot;
+  std::string _prefixHeader;
+  std::string _precompiledHeader;
   std::vector<std::string> _searchPaths;
   std::vector<std::string> _defines;
 };
 
 std::string getSourceTypeForFileName(const std::string &fileName);
+// Same as !getSourceTypeForFileName(fileName).empty(), but safe to call
+// from any thread, and without allocating.
+bool isSourceFileName(const char *fileName);
 std::vector<std::string> recursivelySearchSourceFiles(const std::string &directory);
 std::string expandPath(const std::string &path);
 std::string readFile(const std::string &fileName);
+// Seconds since the epoch, with microseconds.
+double currentTime();
 
 std::string tagbarConfigurations();
 
@@ -0,0 +1,157 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <fstream>
+#include "CostModel.h"
+
+namespace objctags {
+
+namespace {
+
+double getFileSize(const std::string &fileName)
+{
+  struct stat st;
+  if (stat(fileName.c_str(), &st) != 0) {
+    return 0;
+  }
+  return static_cast<double>(st.st_size);
+}
+
+} // end namespace
+
+CostModel::CostModel() :
+  _totalSeconds(0),
+  _totalSize(0)
+{
+  pthread_mutex_init(&_mutex, NULL);
+}
+
+CostModel::~CostModel()
+{
+  pthread_mutex_destroy(&_mutex);
+}
+
+bool CostModel::load(const std::string &fileName)
+{
+  std::ifstream fs(fileName.c_str());
+  if (!fs) {
+    return false;
+  }
+
+  // Each line is "<seconds>\t<size>\t<path>".
+  std::string line;
+  while (std::getline(fs, line)) {
+    size_t first = line.find('\t');
+    size_t second = (first != std::string::npos) ? line.find('\t', first + 1) : std::string::npos;
+    if (second == std::string::npos) {
+      continue;
+    }
+
+    Record record;
+    record.seconds = strtod(line.c_str(), NULL);
+    record.size = strtod(line.c_str() + first + 1, NULL);
+    std::string sourceFile = line.substr(second + 1);
+
+    pthread_mutex_lock(&_mutex);
+    _setRecord(sourceFile, record);
+    pthread_mutex_unlock(&_mutex);
+  }
+
+  return true;
+}
+
+bool CostModel::save(const std::string &fileName) const
+{
+  std::ofstream fs(fileName.c_str());
+  if (!fs) {
+    return false;
+  }
+
+  pthread_mutex_lock(&_mutex);
+  for (std::map<std::string, Record>::const_iterator it = _records.begin(); it != _records.end(); it++) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.6f\t%.0f\t", it->second.seconds, it->second.size);
+    fs << buffer << it->first << "\n";
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  return true;
+}
+
+void CostModel::record(const std::string &sourceFile, double seconds)
+{
+  Record record;
+  record.seconds = seconds;
+  record.size = getFileSize(sourceFile);
+
+  pthread_mutex_lock(&_mutex);
+  _setRecord(sourceFile, record);
+  pthread_mutex_unlock(&_mutex);
+}
+
+void CostModel::_setRecord(const std::string &sourceFile, const Record &record)
+{
+  std::map<std::string, Record>::iterator it = _records.find(sourceFile);
+  if (it != _records.end()) {
+    _totalSeconds -= it->second.seconds;
+    _totalSize -= it->second.size;
+    it->second = record;
+  }
+  else {
+    _records.insert(std::make_pair(sourceFile, record));
+  }
+  _totalSeconds += record.seconds;
+  _totalSize += record.size;
+}
+
+double CostModel::estimate(const std::string &sourceFile) const
+{
+  double size = getFileSize(sourceFile);
+
+  pthread_mutex_lock(&_mutex);
+  double cost;
+  std::map<std::string, Record>::const_iterator it = _records.find(sourceFile);
+  if (it != _records.end() && it->second.size == size) {
+    cost = it->second.seconds;
+  }
+  else if (_totalSize > 0) {
+    cost = size * (_totalSeconds / _totalSize);
+  }
+  else {
+    cost = size;
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  return cost;
+}
+
+std::string getCostFileName(const std::string &tagFileName)
+{
+  return tagFileName + ".cost";
+}
+
+} // end namespace objctags
@@ -0,0 +1,71 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_CostModel_h__
+#define __objctags_CostModel_h__
+
+#include <pthread.h>
+#include <map>
+#include <string>
+
+namespace objctags {
+
+/*
+ * Estimates how long a source file takes to tag.  Parse times measured
+ * in earlier runs are preferred; files without a record are estimated
+ * from their size, scaled by the average parse rate of recorded files.
+ */
+class CostModel {
+public:
+  CostModel();
+  ~CostModel();
+
+  bool load(const std::string &fileName);
+  bool save(const std::string &fileName) const;
+
+  void record(const std::string &sourceFile, double seconds);
+  double estimate(const std::string &sourceFile) const;
+
+private:
+  struct Record {
+    double seconds;
+    double size;
+  };
+
+  mutable pthread_mutex_t _mutex;
+  std::map<std::string, Record> _records;
+  double _totalSeconds;
+  double _totalSize;
+
+  void _setRecord(const std::string &sourceFile, const Record &record);
+
+  CostModel(const CostModel &);
+  CostModel &operator=(const CostModel &);
+};
+
+std::string getCostFileName(const std::string &tagFileName);
+
+} // end namespace objctags
+
+#endif /* __objctags_CostModel_h__ */
@@ -0,0 +1,163 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "DirectoryWalker.h"
+#include "Configuration.h"
+
+namespace objctags {
+
+DirectoryWalker::DirectoryWalker(size_t threadCount) :
+  _threadCount(threadCount > 0 ? threadCount : 1),
+  _listener(NULL),
+  _busyCount(0)
+{
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_cond, NULL);
+}
+
+DirectoryWalker::~DirectoryWalker()
+{
+  pthread_cond_destroy(&_cond);
+  pthread_mutex_destroy(&_mutex);
+}
+
+void DirectoryWalker::walk(const std::string &directory, Listener &listener)
+{
+  if (directory.empty()) {
+    return;
+  }
+
+  _listener = &listener;
+  _directories.assign(1, directory);
+  _busyCount = 0;
+
+  std::vector<pthread_t> threads(_threadCount - 1);
+  for (size_t i = 0; i < threads.size(); i++) {
+    pthread_create(&threads[i], NULL, _threadMain, this);
+  }
+  _run();
+  for (size_t i = 0; i < threads.size(); i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  _listener = NULL;
+}
+
+void *DirectoryWalker::_threadMain(void *data)
+{
+  static_cast<DirectoryWalker *>(data)->_run();
+  return NULL;
+}
+
+// The search is over once no directory is left, and no thread is still
+// reading one, which could turn up more.
+void DirectoryWalker::_run()
+{
+  std::vector<std::string> found;
+  pthread_mutex_lock(&_mutex);
+  while (true) {
+    while (_directories.empty() && _busyCount > 0) {
+      pthread_cond_wait(&_cond, &_mutex);
+    }
+    if (_directories.empty()) {
+      break;
+    }
+
+    std::string directory;
+    directory.swap(_directories.back());
+    _directories.pop_back();
+    _busyCount++;
+    pthread_mutex_unlock(&_mutex);
+
+    found.clear();
+    _readDirectory(directory, found);
+
+    pthread_mutex_lock(&_mutex);
+    _busyCount--;
+    for (size_t i = 0; i < found.size(); i++) {
+      _directories.push_back(std::string());
+      _directories.back().swap(found[i]);
+    }
+    if (!found.empty() || _busyCount == 0) {
+      pthread_cond_broadcast(&_cond);
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+// Only the names of source files and directories are turned into paths.
+// The type of an entry is looked up only if readdir() does not tell it.
+void DirectoryWalker::_readDirectory(const std::string &directory, std::vector<std::string> &directories)
+{
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return;
+  }
+  DIR *dir = fdopendir(fd);
+  if (dir == NULL) {
+    close(fd);
+    return;
+  }
+
+  std::string path = directory + "/";
+  size_t pathLength = path.size();
+  while (true) {
+    struct dirent *ent = readdir(dir);
+    if (ent == NULL) {
+      break;
+    }
+
+    unsigned char type = ent->d_type;
+    if (type == DT_UNKNOWN) {
+      struct stat st;
+      if (fstatat(fd, ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        continue;
+      }
+      type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISLNK(st.st_mode) ? DT_LNK : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+    }
+
+    // Links are taken as files, so links to directories do not make the
+    // search go round in circles.
+    if (type == DT_REG || type == DT_LNK) {
+      if (isSourceFileName(ent->d_name)) {
+        path.resize(pathLength);
+        path += ent->d_name;
+        _listener->foundSourceFile(path);
+      }
+    }
+    else if (type == DT_DIR && strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+      directories.push_back(path.substr(0, pathLength) + ent->d_name);
+    }
+  }
+
+  closedir(dir);
+}
+
+} // end namespace objctags
@@ -0,0 +1,76 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __objctags_DirectoryWalker_h__
+#define __objctags_DirectoryWalker_h__
+
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+namespace objctags {
+
+/*
+ * Searches a directory tree for source files with several threads.
+ * Each thread reads one directory at a time and shares the directories
+ * it finds in there with the others, and the files are reported as
+ * they are found, so that they can be worked on before the search is
+ * over.
+ */
+class DirectoryWalker {
+public:
+  class Listener {
+  public:
+    virtual ~Listener() {}
+    // Called from any of the walking threads, possibly at the same time.
+    virtual void foundSourceFile(const std::string &fileName) = 0;
+  };
+
+  explicit DirectoryWalker(size_t threadCount);
+  ~DirectoryWalker();
+
+  // Returns once the whole tree has been searched.  The calling thread
+  // is one of the walking threads.
+  void walk(const std::string &directory, Listener &listener);
+
+private:
+  size_t _threadCount;
+  Listener *_listener;
+  pthread_mutex_t _mutex;
+  pthread_cond_t _cond;
+  std::vector<std::string> _directories;
+  size_t _busyCount;
+
+  static void *_threadMain(void *data);
+  void _run();
+  void _readDirectory(const std::string &directory, std::vector<std::string> &directories);
+
+  DirectoryWalker(const DirectoryWalker &);
+  DirectoryWalker &operator=(const DirectoryWalker &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_DirectoryWalker_h__ */
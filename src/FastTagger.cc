@@ -0,0 +1,1108 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <vector>
+#include <clang/Basic/LangOptions.h>
+#include <clang/Frontend/CompilerInvocation.h>
+#include <clang/Lex/Lexer.h>
+#include "FastTagger.h"
+#include "LineTable.h"
+
+namespace objctags {
+
+namespace {
+
+struct Token {
+  clang::tok::TokenKind kind;
+  const char *text;
+  unsigned length;
+  bool startOfLine;
+
+  bool is(clang::tok::TokenKind tokenKind) const
+  {
+    return kind == tokenKind;
+  }
+
+  bool isIdentifier() const
+  {
+    return kind == clang::tok::raw_identifier;
+  }
+
+  template <size_t N>
+  bool isIdentifier(const char (&name)[N]) const
+  {
+    return kind == clang::tok::raw_identifier && length == N - 1 && memcmp(text, name, N - 1) == 0;
+  }
+
+  std::string str() const
+  {
+    return std::string(text, length);
+  }
+};
+
+typedef std::vector<Token> TokenVector;
+
+enum ContextKind {
+  context_file,
+  context_namespace,
+  context_record,
+  context_ivars,
+  context_enum,
+  context_objc
+};
+
+enum DiscardMode {
+  discard_none,
+  discard_statement,  // up to the next ';'
+  discard_head        // up to the next ';' or the end of the next body
+};
+
+struct Context {
+  ContextKind kind;
+  std::string name;
+  std::string scope;
+  TokenVector statement;
+  int parenDepth;
+  DiscardMode discard;
+  // Kind of the names declared right after the body of a record, if any.
+  char declaratorKind;
+};
+
+class FastTagger {
+public:
+  FastTagger(llvm::StringRef code, const std::string &fileName, TagInfoVector &tagInfoVector);
+  void run();
+
+private:
+  const char *_begin;
+  clang::Lexer _lexer;
+  LineTable _lineTable;
+  std::string _fileName;
+  TagInfoVector *_tagInfoVector;
+
+  Token _rawPending;
+  bool _hasRawPending;
+  TokenVector _pending;
+  // One entry per open preprocessor conditional: 0 while in the branch
+  // that is looked at, 1 while skipping an '#if 0' that an '#else' may
+  // still take over, 2 while skipping the rest.
+  std::vector<char> _conditions;
+  size_t _inactiveConditions;
+
+  std::vector<Context> _contexts;
+  int _skipDepth;
+  // Swapped with the statement of a context when it is handled, so that
+  // both keep their capacity.
+  TokenVector _statement;
+
+  bool _lex(Token &token);
+  bool _next(Token &token);
+  void _unget(const Token &token);
+  void _directive();
+  void _setCondition(char state);
+
+  void _addTag(const Token &token, const std::string &name, char kind, const std::string &scope);
+  void _pushContext(ContextKind kind, char tagKind, const std::string &name);
+  void _popContext();
+  std::string _getDeclarationScope() const;
+
+  void _handleEnumToken(const Token &token);
+  void _handleObjCDirective(const Token &at);
+  void _handleObjCContainer(const Token &at, const Token &keyword);
+  void _handleObjCMethod(const Token &sign);
+  void _handleOpenBrace();
+  void _handleCloseBrace();
+  void _handleStatement();
+  void _handleDeclarators(TokenVector::const_iterator begin, TokenVector::const_iterator end,
+                          char kind, bool needsType);
+  bool _skipParens(Token &token);
+};
+
+clang::LangOptions getLangOptions()
+{
+  clang::LangOptions langOptions;
+  clang::CompilerInvocation::setLangDefaults(langOptions, clang::IK_ObjCXX);
+  return langOptions;
+}
+
+bool isAttribute(const Token &token)
+{
+  return token.isIdentifier("__attribute__") || token.isIdentifier("__attribute") ||
+         token.isIdentifier("__declspec") || token.isIdentifier("alignas") ||
+         token.isIdentifier("_Alignas") || token.isIdentifier("__asm__") ||
+         token.isIdentifier("__asm") || token.isIdentifier("asm");
+}
+
+// Names like NS_AVAILABLE_IOS are almost always annotation macros.
+bool isMacroLike(const Token &token)
+{
+  if (!token.isIdentifier() || token.length < 2) {
+    return false;
+  }
+  for (unsigned i = 0; i < token.length; i++) {
+    char c = token.text[i];
+    if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool isTypeKeyword(const Token &token)
+{
+  return token.isIdentifier("int") || token.isIdentifier("long") || token.isIdentifier("short") ||
+         token.isIdentifier("char") || token.isIdentifier("unsigned") || token.isIdentifier("signed") ||
+         token.isIdentifier("float") || token.isIdentifier("double") || token.isIdentifier("bool") ||
+         token.isIdentifier("void") || token.isIdentifier("const") || token.isIdentifier("volatile") ||
+         token.isIdentifier("static") || token.isIdentifier("extern") || token.isIdentifier("register") ||
+         token.isIdentifier("inline") || token.isIdentifier("struct") || token.isIdentifier("union") ||
+         token.isIdentifier("enum") || token.isIdentifier("class") || token.isIdentifier("typename") ||
+         token.isIdentifier("id") || token.isIdentifier("BOOL") || token.isIdentifier("instancetype");
+}
+
+bool isRecordKeyword(const Token &token)
+{
+  return token.isIdentifier("struct") || token.isIdentifier("union") ||
+         token.isIdentifier("class") || token.isIdentifier("enum");
+}
+
+bool isEnumMacro(const Token &token)
+{
+  return token.isIdentifier("NS_ENUM") || token.isIdentifier("NS_OPTIONS") ||
+         token.isIdentifier("NS_CLOSED_ENUM") || token.isIdentifier("NS_ERROR_ENUM") ||
+         token.isIdentifier("CF_ENUM") || token.isIdentifier("CF_OPTIONS") ||
+         token.isIdentifier("CF_CLOSED_ENUM");
+}
+
+bool isOpening(const Token &token)
+{
+  return token.is(clang::tok::l_paren) || token.is(clang::tok::l_square);
+}
+
+bool isClosing(const Token &token)
+{
+  return token.is(clang::tok::r_paren) || token.is(clang::tok::r_square);
+}
+
+// Returns the token after the group opened at it.
+TokenVector::const_iterator skipGroup(TokenVector::const_iterator it, TokenVector::const_iterator end)
+{
+  int depth = 0;
+  for (; it != end; it++) {
+    if (isOpening(*it)) {
+      depth++;
+    }
+    else if (isClosing(*it) && --depth == 0) {
+      return it + 1;
+    }
+  }
+  return end;
+}
+
+// Finds the first '(' of a function declarator, skipping those of
+// attributes and annotation macros unless nothing else is left.
+TokenVector::const_iterator findParameters(TokenVector::const_iterator begin, TokenVector::const_iterator end)
+{
+  TokenVector::const_iterator fallback = end;
+  int angleDepth = 0;
+  for (TokenVector::const_iterator it = begin; it != end; ) {
+    if (it->is(clang::tok::less)) {
+      angleDepth++;
+    }
+    else if (it->is(clang::tok::greater) && angleDepth > 0) {
+      angleDepth--;
+    }
+    else if (it->is(clang::tok::equal) && angleDepth == 0) {
+      break;
+    }
+    else if (it->is(clang::tok::l_paren) && angleDepth == 0) {
+      if (it != begin && (it - 1)->isIdentifier() && !isAttribute(*(it - 1))) {
+        if (!isMacroLike(*(it - 1))) {
+          return it;
+        }
+        // 'void FOO(int)', but not 'int foo NS_AVAILABLE(10_9)'.
+        if (fallback == end && (it - 1 == begin || !(it - 2)->isIdentifier() || isTypeKeyword(*(it - 2)))) {
+          fallback = it;
+        }
+      }
+      it = skipGroup(it, end);
+      continue;
+    }
+    else if (it->is(clang::tok::l_square)) {
+      it = skipGroup(it, end);
+      continue;
+    }
+    it++;
+  }
+  return fallback;
+}
+
+// Finds the name introduced by a declarator, e.g. 'foo' in
+// 'int (*foo)(void)', 'NSString *foo NS_UNAVAILABLE' or 'char foo[4]'.
+TokenVector::const_iterator findDeclaratorName(TokenVector::const_iterator begin, TokenVector::const_iterator end)
+{
+  TokenVector::const_iterator name = end;
+  TokenVector::const_iterator previous = end;
+  for (TokenVector::const_iterator it = begin; it != end; ) {
+    if (it->is(clang::tok::l_paren)) {
+      TokenVector::const_iterator next = it + 1;
+      if (next != end && (next->is(clang::tok::star) || next->is(clang::tok::caret) || next->is(clang::tok::amp))) {
+        for (; next != end && !next->is(clang::tok::r_paren); next++) {
+          if (next->isIdentifier() && (next + 1 == end || !(next + 1)->is(clang::tok::coloncolon))) {
+            return next;
+          }
+        }
+      }
+      it = skipGroup(it, end);
+      previous = end;
+      continue;
+    }
+    if (it->is(clang::tok::l_square)) {
+      it = skipGroup(it, end);
+      continue;
+    }
+    if (it->is(clang::tok::equal) || it->is(clang::tok::colon)) {
+      break;
+    }
+    if (it->isIdentifier() && !isAttribute(*it)) {
+      if (name == end || !isMacroLike(*it) || previous == end || isTypeKeyword(*previous)) {
+        name = it;
+      }
+      previous = it;
+    }
+    else {
+      previous = end;
+    }
+    it++;
+  }
+  return name;
+}
+
+FastTagger::FastTagger(llvm::StringRef code, const std::string &fileName, TagInfoVector &tagInfoVector) :
+  _begin(code.data()),
+  // Without a file location, the raw encoding of a token location is its
+  // offset in the buffer.
+  _lexer(clang::SourceLocation(), getLangOptions(), code.data(), code.data(), code.data() + code.size()),
+  _fileName(fileName),
+  _tagInfoVector(&tagInfoVector),
+  _hasRawPending(false),
+  _inactiveConditions(0),
+  _skipDepth(0)
+{
+  _lexer.SetCommentRetentionState(false);
+  _lineTable.assign(code.data(), code.data() + code.size());
+}
+
+bool FastTagger::_lex(Token &token)
+{
+  if (_hasRawPending) {
+    token = _rawPending;
+    _hasRawPending = false;
+    return true;
+  }
+
+  clang::Token rawToken;
+  _lexer.LexFromRawLexer(rawToken);
+  if (rawToken.is(clang::tok::eof)) {
+    return false;
+  }
+  token.kind = rawToken.getKind();
+  token.text = _begin + rawToken.getLocation().getRawEncoding();
+  token.length = rawToken.getLength();
+  token.startOfLine = rawToken.isAtStartOfLine();
+  return true;
+}
+
+bool FastTagger::_next(Token &token)
+{
+  if (!_pending.empty()) {
+    token = _pending.back();
+    _pending.pop_back();
+    return true;
+  }
+
+  while (_lex(token)) {
+    if (token.is(clang::tok::hash) && token.startOfLine) {
+      _directive();
+    }
+    else if (_inactiveConditions == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void FastTagger::_unget(const Token &token)
+{
+  _pending.push_back(token);
+}
+
+void FastTagger::_setCondition(char state)
+{
+  if ((_conditions.back() != 0) != (state != 0)) {
+    _inactiveConditions += (state != 0) ? 1 : -1;
+  }
+  _conditions.back() = state;
+}
+
+void FastTagger::_directive()
+{
+  Token name;
+  if (!_lex(name)) {
+    return;
+  }
+  if (name.startOfLine) {
+    _rawPending = name;
+    _hasRawPending = true;
+    return;
+  }
+
+  Token token;
+  bool hasToken = _lex(token);
+  if (hasToken && token.startOfLine) {
+    _rawPending = token;
+    _hasRawPending = true;
+    hasToken = false;
+  }
+
+  if (name.isIdentifier("if") || name.isIdentifier("ifdef") || name.isIdentifier("ifndef")) {
+    bool isZero = name.isIdentifier("if") && hasToken &&
+                  token.is(clang::tok::numeric_constant) && token.length == 1 && token.text[0] == '0';
+    _conditions.push_back(0);
+    _setCondition(isZero ? 1 : 0);
+  }
+  else if (name.isIdentifier("elif") || name.isIdentifier("else")) {
+    if (!_conditions.empty()) {
+      _setCondition(_conditions.back() == 1 ? 0 : 2);
+    }
+  }
+  else if (name.isIdentifier("endif")) {
+    if (!_conditions.empty()) {
+      _setCondition(0);
+      _conditions.pop_back();
+    }
+  }
+  else if (name.isIdentifier("define") && hasToken && token.isIdentifier() && _inactiveConditions == 0) {
+    _addTag(token, token.str(), tagkind_define, tagextra_filescope);
+  }
+
+  // Skip the rest of the directive, including continued lines.
+  while (hasToken) {
+    if (!_lex(token)) {
+      break;
+    }
+    if (token.startOfLine) {
+      _rawPending = token;
+      _hasRawPending = true;
+      break;
+    }
+  }
+}
+
+void FastTagger::_addTag(const Token &token, const std::string &name, char kind, const std::string &scope)
+{
+  const char *line;
+  size_t lineLength;
+  _lineTable.getLine(static_cast<size_t>(token.text - _begin), line, lineLength);
+
+  _tagInfoVector->add(name, _fileName, line, lineLength, kind, scope);
+}
+
+void FastTagger::_pushContext(ContextKind kind, char tagKind, const std::string &name)
+{
+  const Context &parent = _contexts.back();
+  Context context;
+  context.kind = kind;
+  context.parenDepth = 0;
+  context.discard = discard_none;
+  context.declaratorKind = 0;
+
+  if (tagKind == 0) {
+    context.name = parent.name;
+    context.scope = parent.scope;
+  }
+  else {
+    std::string realName = name.empty() ? "<Anonymous>" : name;
+    // Objective-C containers always live at file scope.
+    if (kind == context_objc || parent.name.empty()) {
+      context.name = realName;
+    }
+    else {
+      context.name = parent.name + tagscope_splitter + realName;
+    }
+    context.scope = getTagKindScopedName(tagKind) + ":" + context.name;
+  }
+
+  _contexts.push_back(context);
+}
+
+void FastTagger::_popContext()
+{
+  if (_contexts.size() > 1) {
+    _contexts.pop_back();
+  }
+}
+
+std::string FastTagger::_getDeclarationScope() const
+{
+  if (_contexts.back().kind == context_objc) {
+    return tagextra_filescope;
+  }
+  return _contexts.back().scope;
+}
+
+void FastTagger::run()
+{
+  Context file;
+  file.kind = context_file;
+  file.scope = tagextra_filescope;
+  file.parenDepth = 0;
+  file.discard = discard_none;
+  file.declaratorKind = 0;
+  _contexts.push_back(file);
+
+  Token token;
+  while (_next(token)) {
+    if (_skipDepth > 0) {
+      if (token.is(clang::tok::l_brace)) {
+        _skipDepth++;
+      }
+      else if (token.is(clang::tok::r_brace)) {
+        _skipDepth--;
+      }
+      else if (token.is(clang::tok::at) && token.startOfLine) {
+        // Braces went out of balance somewhere in a method body.
+        Token keyword;
+        if (_next(keyword)) {
+          _unget(keyword);
+          if (keyword.isIdentifier("end") || keyword.isIdentifier("implementation") ||
+              keyword.isIdentifier("interface")) {
+            _skipDepth = 0;
+            _contexts.back().statement.clear();
+            _contexts.back().discard = discard_none;
+            _handleObjCDirective(token);
+          }
+        }
+      }
+      continue;
+    }
+
+    Context &context = _contexts.back();
+    if (context.kind == context_enum) {
+      _handleEnumToken(token);
+      continue;
+    }
+
+    switch (token.kind) {
+    case clang::tok::at:
+      _handleObjCDirective(token);
+      break;
+
+    case clang::tok::minus:
+    case clang::tok::plus:
+      if (context.kind == context_objc && context.statement.empty() && context.discard == discard_none) {
+        _handleObjCMethod(token);
+      }
+      else {
+        context.statement.push_back(token);
+      }
+      break;
+
+    case clang::tok::l_paren:
+    case clang::tok::l_square:
+      context.parenDepth++;
+      context.statement.push_back(token);
+      break;
+
+    case clang::tok::r_paren:
+    case clang::tok::r_square:
+      if (context.parenDepth > 0) {
+        context.parenDepth--;
+      }
+      context.statement.push_back(token);
+      break;
+
+    case clang::tok::l_brace:
+      if (context.parenDepth > 0) {
+        // A block or a lambda in an argument list.
+        _skipDepth = 1;
+      }
+      else {
+        _handleOpenBrace();
+      }
+      break;
+
+    case clang::tok::r_brace:
+      _handleCloseBrace();
+      break;
+
+    case clang::tok::semi:
+      if (context.parenDepth > 0) {
+        context.statement.push_back(token);
+      }
+      else {
+        _handleStatement();
+      }
+      break;
+
+    case clang::tok::colon:
+      // Access specifiers.
+      if ((context.kind == context_record || context.kind == context_ivars) &&
+          !context.statement.empty() && context.statement.size() <= 2 &&
+          (context.statement[0].isIdentifier("public") || context.statement[0].isIdentifier("protected") ||
+           context.statement[0].isIdentifier("private") || context.statement[0].isIdentifier("signals") ||
+           context.statement[0].isIdentifier("slots") || context.statement[0].isIdentifier("Q_SIGNALS") ||
+           context.statement[0].isIdentifier("Q_SLOTS"))) {
+        context.statement.clear();
+      }
+      else {
+        context.statement.push_back(token);
+      }
+      break;
+
+    default:
+      context.statement.push_back(token);
+      break;
+    }
+  }
+}
+
+void FastTagger::_handleEnumToken(const Token &token)
+{
+  Context &context = _contexts.back();
+  if (token.is(clang::tok::l_paren) || token.is(clang::tok::l_square)) {
+    context.parenDepth++;
+  }
+  else if (token.is(clang::tok::r_paren) || token.is(clang::tok::r_square)) {
+    if (context.parenDepth > 0) {
+      context.parenDepth--;
+    }
+  }
+  else if (token.is(clang::tok::l_brace)) {
+    _skipDepth = 1;
+    return;
+  }
+
+  if ((token.is(clang::tok::comma) && context.parenDepth == 0) || token.is(clang::tok::r_brace)) {
+    if (!context.statement.empty() && context.statement[0].isIdentifier()) {
+      _addTag(context.statement[0], context.statement[0].str(), tagkind_enum_member, context.scope);
+    }
+    context.statement.clear();
+    if (token.is(clang::tok::r_brace)) {
+      _handleCloseBrace();
+    }
+  }
+  else {
+    context.statement.push_back(token);
+  }
+}
+
+void FastTagger::_handleObjCDirective(const Token &at)
+{
+  Context &context = _contexts.back();
+  Token keyword;
+  if (!_next(keyword)) {
+    return;
+  }
+  if (!keyword.isIdentifier()) {
+    _unget(keyword);
+    context.statement.push_back(at);
+    return;
+  }
+
+  if (keyword.isIdentifier("interface") || keyword.isIdentifier("implementation") ||
+      keyword.isIdentifier("protocol")) {
+    // '@protocol(Foo)' is an expression.
+    Token next;
+    if (_next(next)) {
+      _unget(next);
+      if (next.isIdentifier()) {
+        context.statement.clear();
+        context.discard = discard_none;
+        _handleObjCContainer(at, keyword);
+        return;
+      }
+    }
+  }
+  else if (keyword.isIdentifier("end")) {
+    while (_contexts.size() > 1 && _contexts.back().kind != context_objc) {
+      _popContext();
+    }
+    _popContext();
+    _contexts.back().statement.clear();
+    _contexts.back().discard = discard_none;
+    return;
+  }
+  else if (keyword.isIdentifier("optional") || keyword.isIdentifier("required") ||
+           keyword.isIdentifier("public") || keyword.isIdentifier("protected") ||
+           keyword.isIdentifier("private") || keyword.isIdentifier("package")) {
+    return;
+  }
+
+  context.statement.push_back(at);
+  context.statement.push_back(keyword);
+}
+
+void FastTagger::_handleObjCContainer(const Token &at, const Token &keyword)
+{
+  Token name;
+  _next(name);
+  std::string tagName = name.str();
+  char kind = tagkind_interface;
+  if (keyword.isIdentifier("implementation")) {
+    kind = tagkind_implementation;
+  }
+  else if (keyword.isIdentifier("protocol")) {
+    kind = tagkind_protocol;
+  }
+
+  Token token;
+  bool hasToken = _next(token);
+  if (kind == tagkind_protocol && hasToken && (token.is(clang::tok::semi) || token.is(clang::tok::comma))) {
+    // Forward declarations.
+    _unget(token);
+    _contexts.back().discard = discard_statement;
+    return;
+  }
+  if (kind != tagkind_protocol && hasToken && token.is(clang::tok::l_paren)) {
+    std::string category;
+    while (_next(token) && !token.is(clang::tok::r_paren)) {
+      category += token.str();
+    }
+    tagName += "(" + category + ")";
+    kind = (kind == tagkind_interface) ? tagkind_category : tagkind_category_impl;
+    hasToken = _next(token);
+  }
+
+  _addTag(at, tagName, kind, tagextra_filescope);
+  _pushContext(context_objc, kind, tagName);
+
+  // Superclass, adopted protocols and instance variables.
+  while (hasToken) {
+    if (token.is(clang::tok::colon)) {
+      hasToken = _next(token) && _next(token);
+    }
+    else if (token.is(clang::tok::less)) {
+      while ((hasToken = _next(token)) && !token.is(clang::tok::greater)) {
+      }
+      hasToken = hasToken && _next(token);
+    }
+    else if (token.is(clang::tok::l_brace)) {
+      _pushContext(context_ivars, 0, "");
+      return;
+    }
+    else {
+      _unget(token);
+      return;
+    }
+  }
+}
+
+// Skips the group opened at token, leaving token at the one after it.
+bool FastTagger::_skipParens(Token &token)
+{
+  int depth = 1;
+  while (depth > 0) {
+    if (!_next(token)) {
+      return false;
+    }
+    if (token.is(clang::tok::l_paren)) {
+      depth++;
+    }
+    else if (token.is(clang::tok::r_paren)) {
+      depth--;
+    }
+  }
+  return _next(token);
+}
+
+void FastTagger::_handleObjCMethod(const Token &sign)
+{
+  Context &context = _contexts.back();
+  context.discard = discard_head;
+
+  Token token;
+  if (!_next(token)) {
+    return;
+  }
+  if (token.is(clang::tok::l_paren) && !_skipParens(token)) {
+    return;
+  }
+  if (!token.isIdentifier()) {
+    _unget(token);
+    return;
+  }
+
+  std::string selector = token.str();
+  if (_next(token)) {
+    if (!token.is(clang::tok::colon)) {
+      _unget(token);
+    }
+    else {
+      selector += ":";
+      while (_next(token)) {
+        if (token.is(clang::tok::l_paren) && !_skipParens(token)) {
+          break;
+        }
+        // The parameter name.
+        if (token.isIdentifier() && !_next(token)) {
+          break;
+        }
+        if (token.is(clang::tok::colon)) {
+          selector += ":";
+          continue;
+        }
+        if (token.isIdentifier()) {
+          Token colon;
+          if (_next(colon)) {
+            if (colon.is(clang::tok::colon)) {
+              selector += token.str() + ":";
+              continue;
+            }
+            _unget(colon);
+          }
+        }
+        _unget(token);
+        break;
+      }
+    }
+  }
+
+  std::string name = (sign.is(clang::tok::minus) ? "-" : "+") + selector;
+  _addTag(sign, name, tagkind_method, context.scope);
+}
+
+void FastTagger::_handleOpenBrace()
+{
+  Context &context = _contexts.back();
+  TokenVector &statement = _statement;
+  statement.clear();
+  statement.swap(context.statement);
+
+  if (context.discard != discard_none) {
+    if (context.discard == discard_head) {
+      context.discard = discard_none;
+    }
+    _skipDepth = 1;
+    return;
+  }
+
+  TokenVector::const_iterator begin = statement.begin();
+  TokenVector::const_iterator end = statement.end();
+  bool isTypedef = false;
+  for (TokenVector::const_iterator it = begin; it != end; it++) {
+    if (it->isIdentifier("typedef")) {
+      isTypedef = true;
+      break;
+    }
+  }
+
+  // extern "C" {
+  if (statement.size() == 2 && statement[0].isIdentifier("extern") && statement[1].is(clang::tok::string_literal)) {
+    _pushContext(context.kind == context_file ? context_file : context_namespace, 0, "");
+    return;
+  }
+
+  // namespace foo {
+  for (TokenVector::const_iterator it = begin; it != end; it++) {
+    if (it->isIdentifier("namespace")) {
+      std::string name;
+      if (it + 1 != end && (it + 1)->isIdentifier()) {
+        name = (it + 1)->str();
+        _addTag(*(it + 1), name, tagkind_namespace, context.scope);
+      }
+      else {
+        name = "<Anonymous Namespace>";
+      }
+      _pushContext(context_namespace, tagkind_namespace, name);
+      return;
+    }
+    if (!it->isIdentifier("inline")) {
+      break;
+    }
+  }
+
+  // typedef NS_ENUM(NSInteger, Foo) {
+  for (TokenVector::const_iterator it = begin; it != end; it++) {
+    if (isEnumMacro(*it) && it + 1 != end && (it + 1)->is(clang::tok::l_paren)) {
+      TokenVector::const_iterator close = skipGroup(it + 1, end);
+      TokenVector::const_iterator name = close - 2;
+      if (name > it + 1 && name->isIdentifier()) {
+        std::string scope = _getDeclarationScope();
+        _addTag(*name, name->str(), tagkind_enum, scope);
+        if (isTypedef) {
+          _addTag(*name, name->str(), tagkind_typedef, scope);
+        }
+        context.discard = discard_statement;
+        _pushContext(context_enum, tagkind_enum, name->str());
+        return;
+      }
+    }
+  }
+
+  // Initializers.
+  int depth = 0;
+  for (TokenVector::const_iterator it = begin; it != end; it++) {
+    if (isOpening(*it)) {
+      depth++;
+    }
+    else if (isClosing(*it)) {
+      depth--;
+    }
+    else if (it->is(clang::tok::equal) && depth == 0) {
+      TokenVector::const_iterator name = findDeclaratorName(begin, it);
+      if (name != end && name != begin) {
+        char kind = (context.kind == context_record || context.kind == context_ivars) ? tagkind_member : tagkind_variable;
+        _addTag(*name, name->str(), kind, _getDeclarationScope());
+      }
+      context.discard = discard_statement;
+      _skipDepth = 1;
+      return;
+    }
+  }
+
+  // struct, union, class and enum definitions.
+  int angleDepth = 0;
+  for (TokenVector::const_iterator it = begin; it != end; it++) {
+    if (it->is(clang::tok::less)) {
+      angleDepth++;
+    }
+    else if (it->is(clang::tok::greater) && angleDepth > 0) {
+      angleDepth--;
+    }
+    else if (angleDepth == 0 && isRecordKeyword(*it)) {
+      char kind = tagkind_struct;
+      if (it->isIdentifier("union")) {
+        kind = tagkind_union;
+      }
+      else if (it->isIdentifier("class")) {
+        kind = tagkind_class;
+      }
+      else if (it->isIdentifier("enum")) {
+        kind = tagkind_enum;
+        if (it + 1 != end && ((it + 1)->isIdentifier("class") || (it + 1)->isIdentifier("struct"))) {
+          it++;
+        }
+      }
+
+      // The name is the last identifier before the base list, so that
+      // attributes and export macros in between are skipped.
+      TokenVector::const_iterator name = end;
+      bool isFunction = false;
+      int nameAngleDepth = 0;
+      for (TokenVector::const_iterator head = it + 1; head != end; ) {
+        if (head->is(clang::tok::colon) && nameAngleDepth == 0) {
+          break;
+        }
+        if (head->is(clang::tok::less)) {
+          nameAngleDepth++;
+        }
+        else if (head->is(clang::tok::greater) && nameAngleDepth > 0) {
+          nameAngleDepth--;
+        }
+        else if (head->is(clang::tok::l_paren)) {
+          if (head == it + 1 || !(isAttribute(*(head - 1)) || isMacroLike(*(head - 1)))) {
+            isFunction = true;
+            break;
+          }
+          head = skipGroup(head, end);
+          continue;
+        }
+        else if (head->isIdentifier() && nameAngleDepth == 0 && !head->isIdentifier("final") && !isMacroLike(*head)) {
+          name = head;
+        }
+        else if (head->isIdentifier() && nameAngleDepth == 0 && name == end) {
+          name = head;
+        }
+        head++;
+      }
+      if (isFunction) {
+        break;
+      }
+
+      std::string tagName;
+      if (name != end) {
+        tagName = name->str();
+        _addTag(*name, tagName, kind, _getDeclarationScope());
+      }
+      if (isTypedef) {
+        context.declaratorKind = tagkind_typedef;
+      }
+      else if (context.kind == context_record) {
+        context.declaratorKind = tagkind_member;
+      }
+      else {
+        context.declaratorKind = tagkind_variable;
+      }
+      _pushContext(kind == tagkind_enum ? context_enum : context_record, kind, tagName);
+      return;
+    }
+  }
+
+  // Function definitions.
+  TokenVector::const_iterator parameters = findParameters(begin, end);
+  if (parameters != end && (parameters - 1 == begin || !(parameters - 2)->isIdentifier("operator"))) {
+    TokenVector::const_iterator name = parameters - 1;
+    if (!(name->isIdentifier("if") || name->isIdentifier("while") || name->isIdentifier("for") ||
+          name->isIdentifier("switch") || name->isIdentifier("return"))) {
+      _addTag(*name, name->str(), tagkind_function, _getDeclarationScope());
+    }
+  }
+  _skipDepth = 1;
+}
+
+void FastTagger::_handleCloseBrace()
+{
+  if (_contexts.size() == 1) {
+    // Out of balance, most likely because of macros.
+    _contexts.back().statement.clear();
+    _contexts.back().parenDepth = 0;
+    return;
+  }
+  _popContext();
+}
+
+void FastTagger::_handleStatement()
+{
+  Context &context = _contexts.back();
+  TokenVector &statement = _statement;
+  statement.clear();
+  statement.swap(context.statement);
+  char declaratorKind = context.declaratorKind;
+  context.declaratorKind = 0;
+
+  if (context.discard != discard_none) {
+    context.discard = discard_none;
+    return;
+  }
+  if (declaratorKind != 0) {
+    _handleDeclarators(statement.begin(), statement.end(), declaratorKind, false);
+    return;
+  }
+  if (statement.empty()) {
+    return;
+  }
+
+  TokenVector::const_iterator begin = statement.begin();
+  TokenVector::const_iterator end = statement.end();
+
+  if (begin->is(clang::tok::at)) {
+    if (statement.size() > 1 && statement[1].isIdentifier("property")) {
+      begin += 2;
+      if (begin != end && begin->is(clang::tok::l_paren)) {
+        begin = skipGroup(begin, end);
+      }
+      _handleDeclarators(begin, end, tagkind_property, true);
+    }
+    return;
+  }
+
+  if (begin->isIdentifier("using") || begin->isIdentifier("friend") || begin->isIdentifier("namespace") ||
+      begin->isIdentifier("static_assert") || begin->isIdentifier("template") ||
+      begin->isIdentifier("return") || begin->isIdentifier("goto")) {
+    return;
+  }
+
+  bool isTypedef = false;
+  for (TokenVector::const_iterator it = begin; it != end; it++) {
+    if (it->isIdentifier("typedef")) {
+      isTypedef = true;
+      begin = it + 1;
+      break;
+    }
+  }
+  if (isTypedef) {
+    _handleDeclarators(begin, end, tagkind_typedef, false);
+    return;
+  }
+
+  // Forward declarations.
+  if (statement.size() == 2 && isRecordKeyword(statement[0])) {
+    return;
+  }
+
+  char kind = (context.kind == context_record || context.kind == context_ivars) ? tagkind_member : tagkind_variable;
+  TokenVector::const_iterator parameters = findParameters(begin, end);
+  if (parameters != end) {
+    TokenVector::const_iterator next = parameters + 1;
+    bool isPointer = (next != end && (next->is(clang::tok::star) || next->is(clang::tok::caret)));
+    if (!isPointer) {
+      // Prototypes, unless it is a macro invocation on its own.
+      if (parameters - 1 != begin && !(parameters - 2)->isIdentifier("operator")) {
+        _addTag(*(parameters - 1), (parameters - 1)->str(), tagkind_function, _getDeclarationScope());
+      }
+      return;
+    }
+  }
+
+  _handleDeclarators(begin, end, kind, true);
+}
+
+// A type has to precede the name of the first declarator if needsType,
+// otherwise a lone macro would be taken for a declaration.
+void FastTagger::_handleDeclarators(TokenVector::const_iterator begin, TokenVector::const_iterator end,
+                                    char kind, bool needsType)
+{
+  std::string scope = (kind == tagkind_property) ? _contexts.back().scope : _getDeclarationScope();
+  bool isFirst = true;
+  while (begin != end) {
+    TokenVector::const_iterator declaratorEnd = begin;
+    int depth = 0;
+    for (; declaratorEnd != end; declaratorEnd++) {
+      if (isOpening(*declaratorEnd) || declaratorEnd->is(clang::tok::l_brace)) {
+        depth++;
+      }
+      else if (isClosing(*declaratorEnd) || declaratorEnd->is(clang::tok::r_brace)) {
+        depth--;
+      }
+      else if (declaratorEnd->is(clang::tok::comma) && depth == 0) {
+        break;
+      }
+    }
+
+    TokenVector::const_iterator name = findDeclaratorName(begin, declaratorEnd);
+    if (name != declaratorEnd && (name != begin || !isFirst || !needsType)) {
+      _addTag(*name, name->str(), kind, scope);
+    }
+
+    isFirst = false;
+    begin = declaratorEnd;
+    if (begin != end) {
+      begin++;
+    }
+  }
+}
+
+} // end namespace
+
+void runFastTagger(llvm::StringRef code,
+                   const std::string &fileName,
+                   TagInfoVector &tagInfoVector)
+{
+  FastTagger tagger(code, fileName, tagInfoVector);
+  tagger.run();
+}
+
+} // end namespace objctags
@@ -0,0 +1,48 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_FastTagger_h__
+#define __objctags_FastTagger_h__
+
+#include <string>
+#include <llvm/ADT/StringRef.h>
+#include "TagInfo.h"
+
+namespace objctags {
+
+/*
+ * Tags a file from its raw tokens, without preprocessing it or resolving
+ * any header.  This is many times faster than going through the AST and
+ * copes with files that do not parse, but declarations are recognized
+ * from token patterns only, and just the first branch of every
+ * preprocessor conditional is looked at, as ctags does.  code is lexed
+ * in place and must be followed by a null character.
+ */
+void runFastTagger(llvm::StringRef code,
+                   const std::string &fileName,
+                   TagInfoVector &tagInfoVector);
+
+} // end namespace objctags
+
+#endif /* __objctags_FastTagger_h__ */
@@ -0,0 +1,263 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <vector>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "Configuration.h"
+#include "FileWatcher.h"
+
+namespace objctags {
+
+namespace {
+
+std::string getDirectoryName(const std::string &fileName)
+{
+  size_t index = fileName.rfind('/');
+  if (index == std::string::npos) {
+    return ".";
+  }
+  if (index == 0) {
+    return "/";
+  }
+  return fileName.substr(0, index);
+}
+
+time_t getModificationTime(const std::string &fileName)
+{
+  struct stat st;
+  if (stat(fileName.c_str(), &st) != 0) {
+    return 0;
+  }
+  return st.st_mtime;
+}
+
+} // end namespace
+
+FileWatcher::FileWatcher() :
+  _fd(-1)
+{
+#ifdef __linux__
+  _fd = inotify_init();
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+  if (_fd >= 0) {
+    close(_fd);
+  }
+}
+
+bool FileWatcher::addDirectory(const std::string &directory)
+{
+  _directories.insert(directory);
+  if (_fd < 0) {
+    std::vector<std::string> sourceFiles = recursivelySearchSourceFiles(directory);
+    for (size_t i = 0; i < sourceFiles.size(); i++) {
+      _mtimes[sourceFiles[i]] = getModificationTime(sourceFiles[i]);
+    }
+    return true;
+  }
+  return _watchDirectory(directory, NULL);
+}
+
+bool FileWatcher::addFile(const std::string &fileName)
+{
+  _files.insert(fileName);
+  if (_fd < 0) {
+    _mtimes[fileName] = getModificationTime(fileName);
+    return true;
+  }
+
+#ifdef __linux__
+  std::string directory = getDirectoryName(fileName);
+  int wd = inotify_add_watch(_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_MASK_ADD);
+  if (wd < 0) {
+    return false;
+  }
+  if (_watches.find(wd) == _watches.end()) {
+    _watches[wd] = directory;
+  }
+#endif
+  return true;
+}
+
+void FileWatcher::ignore(const std::string &prefix)
+{
+  _ignored.push_back(prefix);
+}
+
+bool FileWatcher::_isIgnored(const std::string &fileName) const
+{
+  for (size_t i = 0; i < _ignored.size(); i++) {
+    if (fileName.compare(0, _ignored[i].size(), _ignored[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int FileWatcher::getFileDescriptor() const
+{
+  return _fd;
+}
+
+// Watches directory and everything below it.  Source files that are
+// already there are added to found, as they may have been written
+// before the watch was in place.
+bool FileWatcher::_watchDirectory(const std::string &directory, std::set<std::string> *found)
+{
+#ifdef __linux__
+  int wd = inotify_add_watch(_fd, directory.c_str(),
+                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF);
+  if (wd < 0) {
+    return false;
+  }
+  _watches[wd] = directory;
+
+  DIR *dir = opendir(directory.c_str());
+  if (dir == NULL) {
+    return true;
+  }
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    std::string fullname = directory + "/" + ent->d_name;
+    if (ent->d_type & DT_DIR) {
+      if (strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+        _watchDirectory(fullname, found);
+      }
+    }
+    else if (found != NULL && (ent->d_type & DT_REG) && isSourceFileName(ent->d_name)) {
+      found->insert(fullname);
+    }
+  }
+  closedir(dir);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FileWatcher::readChanges(std::set<std::string> &changed, std::set<std::string> &removed)
+{
+  if (_fd < 0) {
+    _poll(changed, removed);
+    return;
+  }
+
+#ifdef __linux__
+  char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+  ssize_t length = read(_fd, buffer, sizeof(buffer));
+  if (length <= 0) {
+    return;
+  }
+
+  for (char *p = buffer; p < buffer + length; ) {
+    struct inotify_event *event = reinterpret_cast<struct inotify_event *>(p);
+    p += sizeof(struct inotify_event) + event->len;
+
+    std::map<int, std::string>::iterator watch = _watches.find(event->wd);
+    if (watch == _watches.end()) {
+      continue;
+    }
+    if (event->mask & (IN_DELETE_SELF | IN_IGNORED)) {
+      _watches.erase(watch);
+      continue;
+    }
+    if (event->len == 0) {
+      continue;
+    }
+
+    std::string fullname = watch->second + "/" + event->name;
+    if (event->mask & IN_ISDIR) {
+      if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+        _watchDirectory(fullname, &changed);
+      }
+      continue;
+    }
+
+    // Files named explicitly are watched through their directory, which
+    // may hold files that are none of our business.
+    bool inDirectory = false;
+    for (std::string directory = watch->second; !inDirectory; directory = getDirectoryName(directory)) {
+      inDirectory = (_directories.find(directory) != _directories.end());
+      if (directory == "/" || directory == ".") {
+        break;
+      }
+    }
+    if ((!inDirectory && _files.find(fullname) == _files.end()) || _isIgnored(fullname)) {
+      continue;
+    }
+
+    if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+      changed.insert(fullname);
+      removed.erase(fullname);
+    }
+    else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+      removed.insert(fullname);
+      changed.erase(fullname);
+    }
+  }
+#endif
+}
+
+void FileWatcher::_poll(std::set<std::string> &changed, std::set<std::string> &removed)
+{
+  std::set<std::string> current(_files.begin(), _files.end());
+  for (std::set<std::string>::const_iterator it = _directories.begin(); it != _directories.end(); it++) {
+    std::vector<std::string> sourceFiles = recursivelySearchSourceFiles(*it);
+    current.insert(sourceFiles.begin(), sourceFiles.end());
+  }
+
+  for (std::set<std::string>::const_iterator it = current.begin(); it != current.end(); it++) {
+    time_t mtime = getModificationTime(*it);
+    std::map<std::string, time_t>::iterator known = _mtimes.find(*it);
+    if (mtime == 0 || _isIgnored(*it)) {
+      continue;
+    }
+    if (known == _mtimes.end() || known->second != mtime) {
+      _mtimes[*it] = mtime;
+      changed.insert(*it);
+    }
+  }
+
+  std::map<std::string, time_t>::iterator it = _mtimes.begin();
+  while (it != _mtimes.end()) {
+    if (current.find(it->first) == current.end() || getModificationTime(it->first) == 0) {
+      removed.insert(it->first);
+      _mtimes.erase(it++);
+    }
+    else {
+      it++;
+    }
+  }
+}
+
+} // end namespace objctags
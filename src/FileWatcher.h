@@ -0,0 +1,74 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_FileWatcher_h__
+#define __objctags_FileWatcher_h__
+
+#include <time.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace objctags {
+
+/*
+ * Reports source files that were written or removed.  On Linux this is
+ * driven by inotify; elsewhere the watched files are polled.
+ */
+class FileWatcher {
+public:
+  FileWatcher();
+  ~FileWatcher();
+
+  bool addDirectory(const std::string &directory);
+  bool addFile(const std::string &fileName);
+  // Changes to the files whose path starts with prefix are not reported.
+  void ignore(const std::string &prefix);
+
+  // A descriptor that becomes readable when changes are pending, or -1
+  // if readChanges() has to be called periodically instead.
+  int getFileDescriptor() const;
+
+  void readChanges(std::set<std::string> &changed, std::set<std::string> &removed);
+
+private:
+  int _fd;
+  std::map<int, std::string> _watches;
+  std::set<std::string> _directories;
+  std::set<std::string> _files;
+  std::map<std::string, time_t> _mtimes;
+  std::vector<std::string> _ignored;
+
+  bool _isIgnored(const std::string &fileName) const;
+  bool _watchDirectory(const std::string &directory, std::set<std::string> *found);
+  void _poll(std::set<std::string> &changed, std::set<std::string> &removed);
+
+  FileWatcher(const FileWatcher &);
+  FileWatcher &operator=(const FileWatcher &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_FileWatcher_h__ */
@@ -0,0 +1,99 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "LineTable.h"
+
+namespace objctags {
+
+LineTable::LineTable() :
+  _begin(NULL),
+  _length(0),
+  _last(0)
+{
+}
+
+void LineTable::assign(const char *begin, const char *end)
+{
+  _begin = begin;
+  _length = static_cast<size_t>(end - begin);
+  _breaks.clear();
+  _last = 0;
+
+  const char *p = begin;
+#ifdef __SSE2__
+  // Sixteen bytes at a time, then one bit per line break.
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriageReturn = _mm_set1_epi8('\r');
+  const __m128i null = _mm_setzero_si128();
+  for (; end - p >= 16; p += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i breaks = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, newline),
+                                               _mm_cmpeq_epi8(chunk, carriageReturn)),
+                                  _mm_cmpeq_epi8(chunk, null));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(breaks));
+    while (mask != 0) {
+      _breaks.push_back(static_cast<uint32_t>(p - begin) + __builtin_ctz(mask));
+      mask &= mask - 1;
+    }
+  }
+#endif
+  for (; p < end; p++) {
+    if (*p == '\n' || *p == '\r' || *p == '\0') {
+      _breaks.push_back(static_cast<uint32_t>(p - begin));
+    }
+  }
+}
+
+bool LineTable::_contains(size_t index, size_t offset) const
+{
+  if (index > _breaks.size()) {
+    return false;
+  }
+  return (index == 0 || _breaks[index - 1] < offset) &&
+         (index == _breaks.size() || offset <= _breaks[index]);
+}
+
+void LineTable::getLine(size_t offset, const char *&line, size_t &lineLength)
+{
+  if (!_contains(_last, offset)) {
+    if (_contains(_last + 1, offset)) {
+      _last++;
+    }
+    else {
+      _last = std::lower_bound(_breaks.begin(), _breaks.end(), static_cast<uint32_t>(offset)) - _breaks.begin();
+    }
+  }
+
+  size_t beginOfLine = (_last == 0) ? 0 : _breaks[_last - 1] + 1;
+  size_t endOfLine = (_last == _breaks.size()) ? _length : _breaks[_last];
+  line = _begin + beginOfLine;
+  lineLength = endOfLine - beginOfLine;
+}
+
+} // end namespace objctags
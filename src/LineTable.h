@@ -0,0 +1,66 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __objctags_LineTable_h__
+#define __objctags_LineTable_h__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace objctags {
+
+/*
+ * The line breaks of a buffer, found in one pass, so that the line
+ * around any offset is a lookup rather than a scan in both directions.
+ * Lookups are expected in roughly increasing order, and several on the
+ * same line are answered from the last one.  The buffer has to outlive
+ * the table.
+ */
+class LineTable {
+public:
+  LineTable();
+
+  void assign(const char *begin, const char *end);
+  bool isAssigned() const { return _begin != NULL; }
+
+  // The line containing offset, without its line break.
+  void getLine(size_t offset, const char *&line, size_t &lineLength);
+
+private:
+  const char *_begin;
+  size_t _length;
+  // Offsets of every '\r', '\n' and '\0', any of which ends a line, so
+  // that no pattern written out of a line holds a null character.
+  std::vector<uint32_t> _breaks;
+  // Index of the break ending the line found last.
+  size_t _last;
+
+  bool _contains(size_t index, size_t offset) const;
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_LineTable_h__ */
@@ -0,0 +1,388 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/system_error.h>
+#include "Manifest.h"
+
+namespace objctags {
+
+namespace {
+
+bool parseFileState(const std::string &line, FileState &state, uint64_t *argsHash, std::string &path)
+{
+  unsigned long long size, mtime, hash, extra;
+  int pathOffset = 0;
+  if (argsHash != NULL) {
+    if (sscanf(line.c_str(), "%*c\t%llu\t%llu\t%llx\t%llx\t%n",
+               &size, &mtime, &hash, &extra, &pathOffset) != 4 || pathOffset == 0) {
+      return false;
+    }
+    *argsHash = extra;
+  }
+  else {
+    if (sscanf(line.c_str(), "%*c\t%llu\t%llu\t%llx\t%n",
+               &size, &mtime, &hash, &pathOffset) != 3 || pathOffset == 0) {
+      return false;
+    }
+  }
+
+  state.size = static_cast<off_t>(size);
+  state.mtime = static_cast<time_t>(mtime);
+  state.hash = hash;
+  path = line.substr(pathOffset);
+  return true;
+}
+
+std::string formatFileState(const FileState &state)
+{
+  char buffer[96];
+  snprintf(buffer, sizeof(buffer), "%llu\t%llu\t%016llx\t",
+           static_cast<unsigned long long>(state.size),
+           static_cast<unsigned long long>(state.mtime),
+           static_cast<unsigned long long>(state.hash));
+  return buffer;
+}
+
+// A file written again within the second it was read in keeps its mtime,
+// so the mtime of such a file is not recorded, and its contents are
+// hashed again next time.
+void clearRacyMtime(FileState &state)
+{
+  if (state.mtime >= time(NULL)) {
+    state.mtime = 0;
+  }
+}
+
+bool getFileState(const std::string &fileName, FileState &state, const FileState *previous)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  state.size = st.st_size;
+  state.mtime = st.st_mtime;
+  if (previous != NULL && previous->mtime != 0 &&
+      previous->size == state.size && previous->mtime == state.mtime) {
+    state.hash = previous->hash;
+    close(fd);
+    return true;
+  }
+
+  llvm::OwningPtr<llvm::MemoryBuffer> buffer;
+  bool failed = llvm::MemoryBuffer::getOpenFile(fd, fileName.c_str(), buffer, st.st_size);
+  close(fd);
+  if (failed) {
+    return false;
+  }
+  state.size = static_cast<off_t>(buffer->getBufferSize());
+  state.hash = hashBytes(buffer->getBufferStart(), buffer->getBufferSize());
+  clearRacyMtime(state);
+  return true;
+}
+
+} // end namespace
+
+bool readSourceFile(const std::string &fileName, bool mayMap,
+                    llvm::OwningPtr<llvm::MemoryBuffer> &buffer, FileState &state)
+{
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  if (mayMap) {
+    if (llvm::MemoryBuffer::getOpenFile(fd, fileName.c_str(), buffer, st.st_size)) {
+      close(fd);
+      return false;
+    }
+  }
+  else {
+    // A mapping of a file truncated under it faults on access.
+    buffer.reset(llvm::MemoryBuffer::getNewUninitMemBuffer(static_cast<size_t>(st.st_size), fileName));
+    char *data = const_cast<char *>(buffer->getBufferStart());
+    size_t length = 0;
+    while (length < buffer->getBufferSize()) {
+      ssize_t count = read(fd, data + length, buffer->getBufferSize() - length);
+      if (count < 0) {
+        close(fd);
+        return false;
+      }
+      if (count == 0) {
+        break;
+      }
+      length += static_cast<size_t>(count);
+    }
+    if (length < buffer->getBufferSize()) {
+      buffer.reset(llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(data, length), fileName));
+    }
+  }
+  close(fd);
+
+  state.size = static_cast<off_t>(buffer->getBufferSize());
+  state.mtime = st.st_mtime;
+  state.hash = hashBytes(buffer->getBufferStart(), buffer->getBufferSize());
+  clearRacyMtime(state);
+  return true;
+}
+
+Manifest::Manifest()
+{
+  pthread_mutex_init(&_mutex, NULL);
+}
+
+Manifest::~Manifest()
+{
+  pthread_mutex_destroy(&_mutex);
+}
+
+bool Manifest::load(const std::string &fileName)
+{
+  std::ifstream fs(fileName.c_str());
+  if (!fs) {
+    return false;
+  }
+
+  // The manifest is made of
+  //   "S\t<size>\t<mtime>\t<hash>\t<args hash>\t<path>" for a source file,
+  //   "D\t<path>" for each header included by the preceding source file,
+  //   "H\t<size>\t<mtime>\t<hash>\t<path>" for each header.
+  pthread_mutex_lock(&_mutex);
+  ManifestEntry *current = NULL;
+  std::string line;
+  while (std::getline(fs, line)) {
+    std::string path;
+    if (line.compare(0, 2, "S\t") == 0) {
+      ManifestEntry entry;
+      if (parseFileState(line, entry.state, &entry.argsHash, path)) {
+        current = &(_entries[path] = entry);
+      }
+      else {
+        current = NULL;
+      }
+    }
+    else if (line.compare(0, 2, "D\t") == 0) {
+      if (current != NULL) {
+        current->dependencies.insert(line.substr(2));
+      }
+    }
+    else if (line.compare(0, 2, "H\t") == 0) {
+      FileState state;
+      if (parseFileState(line, state, NULL, path)) {
+        _headers[path] = state;
+      }
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  return true;
+}
+
+bool Manifest::save(const std::string &fileName) const
+{
+  std::ofstream fs(fileName.c_str());
+  if (!fs) {
+    return false;
+  }
+
+  pthread_mutex_lock(&_mutex);
+  std::set<std::string> usedHeaders;
+  for (std::map<std::string, ManifestEntry>::const_iterator it = _entries.begin(); it != _entries.end(); it++) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%016llx\t", static_cast<unsigned long long>(it->second.argsHash));
+    fs << "S\t" << formatFileState(it->second.state) << buffer << it->first << "\n";
+
+    const std::set<std::string> &dependencies = it->second.dependencies;
+    for (std::set<std::string>::const_iterator dep = dependencies.begin(); dep != dependencies.end(); dep++) {
+      fs << "D\t" << *dep << "\n";
+      usedHeaders.insert(*dep);
+    }
+  }
+  for (std::map<std::string, FileState>::const_iterator it = _headers.begin(); it != _headers.end(); it++) {
+    if (usedHeaders.find(it->first) != usedHeaders.end()) {
+      fs << "H\t" << formatFileState(it->second) << it->first << "\n";
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  return !fs.fail();
+}
+
+bool Manifest::isClean(const std::string &sourceFile, uint64_t argsHash)
+{
+  pthread_mutex_lock(&_mutex);
+  std::map<std::string, ManifestEntry>::const_iterator it = _entries.find(sourceFile);
+  bool found = (it != _entries.end());
+  ManifestEntry entry;
+  if (found) {
+    entry = it->second;
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  if (!found || entry.argsHash != argsHash) {
+    return false;
+  }
+
+  // Touched but possibly unchanged, e.g. after a checkout.
+  FileState state;
+  if (!getFileState(sourceFile, state, &entry.state) || state.size != entry.state.size ||
+      state.hash != entry.state.hash) {
+    return false;
+  }
+
+  const std::set<std::string> &dependencies = entry.dependencies;
+  for (std::set<std::string>::const_iterator dep = dependencies.begin(); dep != dependencies.end(); dep++) {
+    if (!_isHeaderClean(*dep)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool Manifest::_isHeaderClean(const std::string &header)
+{
+  pthread_mutex_lock(&_mutex);
+  std::map<std::string, bool>::const_iterator checked = _checkedHeaders.find(header);
+  if (checked != _checkedHeaders.end()) {
+    bool clean = checked->second;
+    pthread_mutex_unlock(&_mutex);
+    return clean;
+  }
+
+  std::map<std::string, FileState>::const_iterator it = _headers.find(header);
+  bool found = (it != _headers.end());
+  FileState previous;
+  if (found) {
+    previous = it->second;
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  // Each header is checked at most once per run, however many files include it.
+  FileState state;
+  bool clean = found && getFileState(header, state, &previous) && state.hash == previous.hash;
+
+  pthread_mutex_lock(&_mutex);
+  _checkedHeaders[header] = clean;
+  pthread_mutex_unlock(&_mutex);
+
+  return clean;
+}
+
+void Manifest::update(const std::string &sourceFile, const FileState &state, uint64_t argsHash,
+                      const std::set<std::string> &dependencies)
+{
+  ManifestEntry entry;
+  entry.state = state;
+  entry.argsHash = argsHash;
+  entry.dependencies = dependencies;
+
+  // Record the headers as they are now, unless another file already did.
+  std::map<std::string, FileState> headers;
+  pthread_mutex_lock(&_mutex);
+  for (std::set<std::string>::const_iterator dep = dependencies.begin(); dep != dependencies.end(); dep++) {
+    std::map<std::string, bool>::const_iterator checked = _checkedHeaders.find(*dep);
+    if (checked == _checkedHeaders.end() || !checked->second) {
+      headers[*dep] = FileState();
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  for (std::map<std::string, FileState>::iterator it = headers.begin(); it != headers.end(); ) {
+    if (getFileState(it->first, it->second, NULL)) {
+      it++;
+    }
+    else {
+      headers.erase(it++);
+    }
+  }
+
+  pthread_mutex_lock(&_mutex);
+  _entries[sourceFile] = entry;
+  for (std::map<std::string, FileState>::const_iterator it = headers.begin(); it != headers.end(); it++) {
+    _headers[it->first] = it->second;
+    _checkedHeaders[it->first] = true;
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+void Manifest::retain(const std::set<std::string> &sourceFiles)
+{
+  pthread_mutex_lock(&_mutex);
+  std::map<std::string, ManifestEntry>::iterator it = _entries.begin();
+  while (it != _entries.end()) {
+    if (sourceFiles.find(it->first) == sourceFiles.end()) {
+      _entries.erase(it++);
+    }
+    else {
+      it++;
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+void Manifest::getDependents(const std::string &header, std::set<std::string> &dependents) const
+{
+  pthread_mutex_lock(&_mutex);
+  for (std::map<std::string, ManifestEntry>::const_iterator it = _entries.begin(); it != _entries.end(); it++) {
+    if (it->second.dependencies.find(header) != it->second.dependencies.end()) {
+      dependents.insert(it->first);
+    }
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+uint64_t hashArgs(const std::vector<std::string> &args)
+{
+  uint64_t hash = hashBytes(NULL, 0);
+  for (size_t i = 0; i < args.size(); i++) {
+    hash = hashBytes(args[i].c_str(), args[i].size() + 1, hash);
+  }
+  return hash;
+}
+
+std::string getManifestFileName(const std::string &tagFileName)
+{
+  return tagFileName + ".manifest";
+}
+
+} // end namespace objctags
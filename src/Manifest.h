@@ -0,0 +1,105 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_Manifest_h__
+#define __objctags_Manifest_h__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include "Hash.h"
+
+namespace objctags {
+
+struct FileState {
+  off_t size;
+  time_t mtime;
+  uint64_t hash;
+};
+
+struct ManifestEntry {
+  FileState state;
+  uint64_t argsHash;
+  std::set<std::string> dependencies;
+};
+
+/*
+ * Remembers the state of every source file that went into a tags file,
+ * together with the headers it included, so that an incremental run
+ * only re-parses the files affected by a change.
+ */
+class Manifest {
+public:
+  Manifest();
+  ~Manifest();
+
+  bool load(const std::string &fileName);
+  bool save(const std::string &fileName) const;
+
+  // A file is clean if neither it nor any header it included changed.
+  // Contents are only hashed if the size or mtime changed.
+  bool isClean(const std::string &sourceFile, uint64_t argsHash);
+
+  // state is what readSourceFile() said about the contents that were
+  // tagged, rather than what the file is like by now.
+  void update(const std::string &sourceFile, const FileState &state, uint64_t argsHash,
+              const std::set<std::string> &dependencies);
+  void retain(const std::set<std::string> &sourceFiles);
+
+  // Adds the source files that included header to dependents.
+  void getDependents(const std::string &header, std::set<std::string> &dependents) const;
+
+private:
+  mutable pthread_mutex_t _mutex;
+  std::map<std::string, ManifestEntry> _entries;
+  std::map<std::string, FileState> _headers;
+  std::map<std::string, bool> _checkedHeaders;
+
+  bool _isHeaderClean(const std::string &header);
+
+  Manifest(const Manifest &);
+  Manifest &operator=(const Manifest &);
+};
+
+// Reads fileName into a null-terminated buffer, and takes its state from
+// the same descriptor.  The mtime is left at 0 if the file could still
+// change within the second it was read in.  Large files are mapped if
+// mayMap is set, which is only safe if nothing rewrites them meanwhile.
+bool readSourceFile(const std::string &fileName, bool mayMap,
+                    llvm::OwningPtr<llvm::MemoryBuffer> &buffer, FileState &state);
+
+uint64_t hashArgs(const std::vector<std::string> &args);
+
+std::string getManifestFileName(const std::string &tagFileName);
+
+} // end namespace objctags
+
+#endif /* __objctags_Manifest_h__ */
@@ -0,0 +1,459 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <clang/Basic/SourceManager.h>
+#include <clang/Frontend/CompilerInstance.h>
+#include <clang/Frontend/FrontendActions.h>
+#include <clang/Lex/PPCallbacks.h>
+#include <clang/Lex/Preprocessor.h>
+#include "ClangTool.h"
+#include "Manifest.h"
+#include "PrecompiledHeader.h"
+
+namespace objctags {
+
+namespace {
+
+// Collects the non-system headers a prefix header includes, which are
+// not seen by the preprocessor callbacks of the files using it.
+class InputCollector : public clang::PPCallbacks {
+public:
+  InputCollector(std::set<std::string> &inputs, clang::SourceManager &sourceManager) :
+    _inputs(inputs),
+    _sourceManager(sourceManager)
+  {
+  }
+
+  virtual void FileChanged(clang::SourceLocation loc,
+                           FileChangeReason reason,
+                           clang::SrcMgr::CharacteristicKind fileType,
+                           clang::FileID prevFID)
+  {
+    if (reason != EnterFile || fileType != clang::SrcMgr::C_User) {
+      return;
+    }
+    clang::FileID fileID = _sourceManager.getFileID(_sourceManager.getExpansionLoc(loc));
+    const clang::FileEntry *fileEntry = _sourceManager.getFileEntryForID(fileID);
+    if (fileEntry != NULL) {
+      _inputs.insert(fileEntry->getName());
+    }
+  }
+
+private:
+  std::set<std::string> &_inputs;
+  clang::SourceManager &_sourceManager;
+};
+
+class GeneratePCHAction : public clang::GeneratePCHAction {
+public:
+  explicit GeneratePCHAction(std::set<std::string> &inputs) :
+    _inputs(inputs)
+  {
+  }
+
+protected:
+  virtual bool BeginSourceFileAction(clang::CompilerInstance &compiler, llvm::StringRef file)
+  {
+    compiler.getPreprocessor().addPPCallbacks(new InputCollector(_inputs, compiler.getSourceManager()));
+    return clang::GeneratePCHAction::BeginSourceFileAction(compiler, file);
+  }
+
+private:
+  std::set<std::string> &_inputs;
+};
+
+} // end namespace
+
+PrecompiledHeaderCache::PrecompiledHeaderCache() :
+  _generation(0),
+  _buildCount(0)
+{
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_cond, NULL);
+}
+
+PrecompiledHeaderCache::~PrecompiledHeaderCache()
+{
+  for (size_t i = 0; i < _files.size(); i++) {
+    unlink(_files[i].c_str());
+  }
+  if (!_directory.empty()) {
+    rmdir(_directory.c_str());
+  }
+  pthread_cond_destroy(&_cond);
+  pthread_mutex_destroy(&_mutex);
+}
+
+std::string PrecompiledHeaderCache::get(const Configuration &config, std::set<std::string> *inputs)
+{
+  if (config.getPrefixHeader().empty()) {
+    return "";
+  }
+
+  // Other workers needing the same precompiled header wait while it is
+  // being built, as they would otherwise parse the same prefix
+  // themselves.  The others go on.
+  uint64_t key = hashArgs(config.getClangArgs());
+  pthread_mutex_lock(&_mutex);
+  std::map<uint64_t, Entry>::iterator it;
+  while ((it = _entries.find(key)) != _entries.end() && it->second.building) {
+    pthread_cond_wait(&_cond, &_mutex);
+  }
+
+  Entry entry;
+  if (it != _entries.end()) {
+    entry = it->second;
+  }
+  else {
+    std::string outputFile = _getOutputFile();
+    unsigned long generation = _generation;
+    _entries[key].building = true;
+    pthread_mutex_unlock(&_mutex);
+
+    entry.inputs.insert(config.getPrefixHeader());
+    bool success = !outputFile.empty() && _build(config, outputFile, entry.inputs);
+
+    // No precompiled header is written if the prefix header has errors.
+    struct stat st;
+    bool written = !outputFile.empty() && stat(outputFile.c_str(), &st) == 0;
+    if (success && written) {
+      entry.fileName = outputFile;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    if (written) {
+      _files.push_back(outputFile);
+    }
+    // If an input changed meanwhile, the next get() builds it again.
+    if (generation == _generation) {
+      _entries[key] = entry;
+    }
+    else {
+      _entries.erase(key);
+    }
+    pthread_cond_broadcast(&_cond);
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  if (inputs != NULL) {
+    inputs->insert(entry.inputs.begin(), entry.inputs.end());
+  }
+  return entry.fileName;
+}
+
+// Which inputs a build in progress reads is not known yet, so all of
+// them are dropped when done.
+bool PrecompiledHeaderCache::invalidate(const std::set<std::string> &changed)
+{
+  pthread_mutex_lock(&_mutex);
+  bool found = false;
+  std::map<uint64_t, Entry>::iterator it = _entries.begin();
+  while (it != _entries.end()) {
+    const std::set<std::string> &inputs = it->second.inputs;
+    bool stale = it->second.building;
+    for (std::set<std::string>::const_iterator file = changed.begin(); !stale && file != changed.end(); file++) {
+      stale = (inputs.find(*file) != inputs.end());
+    }
+    if (stale && !it->second.building) {
+      _entries.erase(it++);
+    }
+    else {
+      it++;
+    }
+    found = found || stale;
+  }
+  if (found) {
+    _generation++;
+  }
+  pthread_mutex_unlock(&_mutex);
+  return found;
+}
+
+unsigned long PrecompiledHeaderCache::getGeneration() const
+{
+  pthread_mutex_lock(&_mutex);
+  unsigned long generation = _generation;
+  pthread_mutex_unlock(&_mutex);
+  return generation;
+}
+
+// Called with the mutex held.
+std::string PrecompiledHeaderCache::_getOutputFile()
+{
+  if (_directory.empty()) {
+    const char *tmpdir = getenv("TMPDIR");
+    std::string pattern = std::string((tmpdir != NULL && *tmpdir != '\0') ? tmpdir : "/tmp") + "/objctags.XXXXXX";
+    std::vector<char> buffer(pattern.begin(), pattern.end());
+    buffer.push_back('\0');
+    if (mkdtemp(&buffer[0]) == NULL) {
+      return "";
+    }
+    _directory = &buffer[0];
+  }
+
+  // Builds still running have not added their file yet.
+  char name[32];
+  snprintf(name, sizeof(name), "/prefix-%lu.pch", _buildCount++);
+  return _directory + name;
+}
+
+bool PrecompiledHeaderCache::_build(const Configuration &config, const std::string &outputFile,
+                                    std::set<std::string> &inputs)
+{
+  Configuration pchConfig = config;
+  pchConfig.setPrefixHeader("");
+  pchConfig.setPrecompiledHeader("");
+  std::string sourceType = config.getSourceType();
+  if (!sourceType.empty() && sourceType.find("-header") == std::string::npos) {
+    pchConfig.setSourceType(sourceType + "-header");
+  }
+
+  const std::string &prefixHeader = config.getPrefixHeader();
+  return runClangToolOnCodeWithArgs(new GeneratePCHAction(inputs),
+                                    readFile(prefixHeader),
+                                    pchConfig.getClangArgs(),
+                                    prefixHeader,
+                                    outputFile);
+}
+
+std::string findXcodePrefixHeader(const std::string &sourceFile,
+                                  std::map<std::string, std::string> &cache)
+{
+  std::vector<std::string> searched;
+  std::string prefixHeader;
+
+  std::string directory = sourceFile;
+  size_t index;
+  while ((index = directory.rfind('/')) != std::string::npos && index > 0) {
+    directory.erase(index);
+
+    std::map<std::string, std::string>::const_iterator it = cache.find(directory);
+    if (it != cache.end()) {
+      prefixHeader = it->second;
+      break;
+    }
+    searched.push_back(directory);
+
+    DIR *dir = opendir(directory.c_str());
+    if (dir == NULL) {
+      continue;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+      size_t length = strlen(ent->d_name);
+      if (length > 11 && strcmp(ent->d_name + length - 11, "-Prefix.pch") == 0) {
+        prefixHeader = directory + "/" + ent->d_name;
+        break;
+      }
+    }
+    closedir(dir);
+
+    if (!prefixHeader.empty()) {
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < searched.size(); i++) {
+    cache[searched[i]] = prefixHeader;
+  }
+
+  return prefixHeader;
+}
+
+namespace {
+
+// Only the head of each file is looked at.
+const size_t includeScanSize = 4096;
+
+std::vector<std::string> getLeadingSystemIncludes(const std::string &sourceFile)
+{
+  std::vector<std::string> includes;
+
+  int fd = open(sourceFile.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return includes;
+  }
+  char buffer[includeScanSize];
+  ssize_t length = read(fd, buffer, sizeof(buffer));
+  close(fd);
+  if (length <= 0) {
+    return includes;
+  }
+
+  const char *p = buffer;
+  const char *end = buffer + length;
+  bool inComment = false;
+  while (p < end) {
+    const char *eol = static_cast<const char *>(memchr(p, '\n', end - p));
+    if (eol == NULL) {
+      break;
+    }
+    std::string line(p, eol);
+    p = eol + 1;
+
+    size_t begin = line.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+      continue;
+    }
+    line = line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1);
+
+    if (inComment) {
+      inComment = (line.find("*/") == std::string::npos);
+      continue;
+    }
+    if (line.compare(0, 2, "//") == 0) {
+      continue;
+    }
+    if (line.compare(0, 2, "/*") == 0) {
+      inComment = (line.find("*/") == std::string::npos);
+      continue;
+    }
+
+    if (line.compare(0, 8, "#import ") == 0 || line.compare(0, 9, "#include ") == 0) {
+      size_t openBracket = line.find('<');
+      size_t closeBracket = line.find('>');
+      if (openBracket != std::string::npos && closeBracket != std::string::npos && openBracket < closeBracket) {
+        includes.push_back(line.substr(0, closeBracket + 1));
+        continue;
+      }
+    }
+
+    // The system include block ends at the first line of anything else,
+    // including a project header, since a prefix could not go past it.
+    break;
+  }
+
+  return includes;
+}
+
+} // end namespace
+
+// The prefix grows one line at a time, with the line that most of the
+// files it still opens go on with.
+std::vector<std::string> findCommonSystemIncludes(const std::vector<std::string> &sourceFiles)
+{
+  std::vector<std::string> common;
+  if (sourceFiles.size() < 2) {
+    return common;
+  }
+
+  std::vector<std::vector<std::string> > blocks(sourceFiles.size());
+  std::vector<size_t> matching;
+  for (size_t i = 0; i < sourceFiles.size(); i++) {
+    blocks[i] = getLeadingSystemIncludes(sourceFiles[i]);
+    matching.push_back(i);
+  }
+
+  while (true) {
+    size_t position = common.size();
+    std::vector<std::string> order;
+    std::map<std::string, size_t> counts;
+    for (size_t i = 0; i < matching.size(); i++) {
+      const std::vector<std::string> &block = blocks[matching[i]];
+      if (block.size() > position && counts[block[position]]++ == 0) {
+        order.push_back(block[position]);
+      }
+    }
+
+    std::string best;
+    size_t bestCount = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+      if (counts[order[i]] > bestCount) {
+        best = order[i];
+        bestCount = counts[best];
+      }
+    }
+    if (bestCount * 2 < sourceFiles.size()) {
+      break;
+    }
+
+    common.push_back(best);
+    std::vector<size_t> next;
+    for (size_t i = 0; i < matching.size(); i++) {
+      if (blocks[matching[i]].size() > position && blocks[matching[i]][position] == best) {
+        next.push_back(matching[i]);
+      }
+    }
+    matching.swap(next);
+  }
+  return common;
+}
+
+bool startsWithIncludes(const std::string &sourceFile, const std::vector<std::string> &includes)
+{
+  if (includes.empty()) {
+    return false;
+  }
+  std::vector<std::string> block = getLeadingSystemIncludes(sourceFile);
+  return block.size() >= includes.size() && std::equal(includes.begin(), includes.end(), block.begin());
+}
+
+bool writePrefixHeader(const std::string &fileName, const std::vector<std::string> &lines)
+{
+  std::string content;
+  for (size_t i = 0; i < lines.size(); i++) {
+    content += lines[i];
+    content += "\n";
+  }
+
+  struct stat st;
+  if (stat(fileName.c_str(), &st) == 0 && readFile(fileName) == content) {
+    return true;
+  }
+
+  std::ofstream fs(fileName.c_str());
+  fs << content;
+  return !fs.fail();
+}
+
+std::vector<std::string> readPrefixHeader(const std::string &fileName)
+{
+  std::vector<std::string> lines;
+  std::istringstream ss(readFile(fileName));
+  std::string line;
+  while (std::getline(ss, line)) {
+    if (!line.empty()) {
+      lines.push_back(line);
+    }
+  }
+  return lines;
+}
+
+std::string getPrefixHeaderFileName(const std::string &tagFileName)
+{
+  return tagFileName + ".prefix";
+}
+
+} // end namespace objctags
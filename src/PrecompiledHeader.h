@@ -0,0 +1,114 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_PrecompiledHeader_h__
+#define __objctags_PrecompiledHeader_h__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "Configuration.h"
+
+namespace objctags {
+
+/*
+ * Builds a precompiled header for the prefix header of each distinct
+ * Configuration the first time it is needed, so that the common
+ * #import prefix shared by most files is parsed only once per run.
+ * Only the threads needing a precompiled header that is being built
+ * wait for it.  The precompiled headers live in a temporary directory
+ * that is removed with the cache.
+ */
+class PrecompiledHeaderCache {
+public:
+  PrecompiledHeaderCache();
+  ~PrecompiledHeaderCache();
+
+  // Returns an empty string if config has no prefix header, or if the
+  // prefix header cannot be precompiled.  If inputs is given, it
+  // receives the prefix header and the non-system headers it includes,
+  // which the files parsed with it depend on as well.
+  std::string get(const Configuration &config, std::set<std::string> *inputs = NULL);
+
+  // Makes get() rebuild the precompiled headers that any of the given
+  // files went into, and returns whether there was one.  Files already
+  // handed out stay valid until the cache is destroyed.
+  bool invalidate(const std::set<std::string> &changed);
+  // Changes whenever invalidate() returns true.
+  unsigned long getGeneration() const;
+
+private:
+  struct Entry {
+    Entry() : building(false) {}
+
+    bool building;
+    std::string fileName;
+    std::set<std::string> inputs;
+  };
+
+  mutable pthread_mutex_t _mutex;
+  pthread_cond_t _cond;
+  std::string _directory;
+  std::map<uint64_t, Entry> _entries;
+  std::vector<std::string> _files;
+  unsigned long _generation;
+  unsigned long _buildCount;
+
+  std::string _getOutputFile();
+  bool _build(const Configuration &config, const std::string &outputFile, std::set<std::string> &inputs);
+
+  PrecompiledHeaderCache(const PrecompiledHeaderCache &);
+  PrecompiledHeaderCache &operator=(const PrecompiledHeaderCache &);
+};
+
+// Finds the Xcode-style '*-Prefix.pch' in the directory of sourceFile or
+// one of its parents.  Directories already searched are kept in cache.
+std::string findXcodePrefixHeader(const std::string &sourceFile,
+                                  std::map<std::string, std::string> &cache);
+
+// Returns the longest run of system #import/#include lines that opens at
+// least half of the given files.  Comments may come in between, but
+// nothing else.
+std::vector<std::string> findCommonSystemIncludes(const std::vector<std::string> &sourceFiles);
+
+// Whether sourceFile opens with the given system includes, so that a
+// prefix header made of them can stand in for its first lines.
+bool startsWithIncludes(const std::string &sourceFile, const std::vector<std::string> &includes);
+
+// Writes the lines to fileName, leaving the file untouched if it already
+// has that content so that its modification time stays stable.
+bool writePrefixHeader(const std::string &fileName, const std::vector<std::string> &lines);
+// The lines written by writePrefixHeader(), or none if there is no such file.
+std::vector<std::string> readPrefixHeader(const std::string &fileName);
+
+// Deliberately not a source file extension, so that recursive scans of a
+// tree holding the tags file do not pick it up.
+std::string getPrefixHeaderFileName(const std::string &tagFileName);
+
+} // end namespace objctags
+
+#endif /* __objctags_PrecompiledHeader_h__ */
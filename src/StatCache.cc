@@ -0,0 +1,137 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "StatCache.h"
+
+namespace objctags {
+
+StatCacheTable::StatCacheTable() :
+  _generation(0)
+{
+  pthread_rwlock_init(&_lock, NULL);
+}
+
+StatCacheTable::~StatCacheTable()
+{
+  pthread_rwlock_destroy(&_lock);
+}
+
+bool StatCacheTable::lookup(const std::string &path, bool &exists, struct stat &st) const
+{
+  pthread_rwlock_rdlock(&_lock);
+  std::map<std::string, Entry>::const_iterator it = _entries.find(path);
+  bool found = (it != _entries.end());
+  if (found) {
+    exists = it->second.exists;
+    st = it->second.st;
+  }
+  pthread_rwlock_unlock(&_lock);
+  return found;
+}
+
+void StatCacheTable::insert(const std::string &path, bool exists, const struct stat &st)
+{
+  Entry entry;
+  entry.exists = exists;
+  entry.st = st;
+
+  pthread_rwlock_wrlock(&_lock);
+  _entries[path] = entry;
+  pthread_rwlock_unlock(&_lock);
+}
+
+namespace {
+
+std::string getBaseName(const std::string &path)
+{
+  size_t index = path.rfind('/');
+  return (index != std::string::npos) ? path.substr(index + 1) : path;
+}
+
+} // end namespace
+
+// Headers are looked up through search paths that may be spelled in many
+// ways, so every entry with the same last component goes.
+void StatCacheTable::remove(const std::set<std::string> &fileNames)
+{
+  if (fileNames.empty()) {
+    return;
+  }
+  std::set<std::string> baseNames;
+  for (std::set<std::string>::const_iterator it = fileNames.begin(); it != fileNames.end(); it++) {
+    baseNames.insert(getBaseName(*it));
+  }
+
+  pthread_rwlock_wrlock(&_lock);
+  std::map<std::string, Entry>::iterator it = _entries.begin();
+  while (it != _entries.end()) {
+    if (baseNames.find(getBaseName(it->first)) != baseNames.end()) {
+      _entries.erase(it++);
+    }
+    else {
+      it++;
+    }
+  }
+  _generation++;
+  pthread_rwlock_unlock(&_lock);
+}
+
+unsigned long StatCacheTable::getGeneration() const
+{
+  pthread_rwlock_rdlock(&_lock);
+  unsigned long generation = _generation;
+  pthread_rwlock_unlock(&_lock);
+  return generation;
+}
+
+SharedStatCache::SharedStatCache(StatCacheTable *table) :
+  _table(table)
+{
+}
+
+clang::FileSystemStatCache::LookupResult SharedStatCache::getStat(const char *path,
+                                                                  struct stat &statBuf,
+                                                                  int *fileDescriptor)
+{
+  bool exists;
+  if (_table->lookup(path, exists, statBuf)) {
+    // A file found in the cache is left unopened; the file manager opens
+    // it by name if it is actually read.
+    return exists ? CacheExists : CacheMissing;
+  }
+
+  LookupResult result = statChained(path, statBuf, fileDescriptor);
+  if (result == CacheMissing) {
+    struct stat empty;
+    memset(&empty, 0, sizeof(empty));
+    _table->insert(path, false, empty);
+  }
+  else {
+    _table->insert(path, true, statBuf);
+  }
+  return result;
+}
+
+} // end namespace objctags
@@ -0,0 +1,89 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_StatCache_h__
+#define __objctags_StatCache_h__
+
+#include <pthread.h>
+#include <sys/stat.h>
+#include <map>
+#include <set>
+#include <string>
+#include <clang/Basic/FileSystemStatCache.h>
+
+namespace objctags {
+
+/*
+ * The results of every stat() done while looking up headers, shared by
+ * all threads for the whole run.  Misses are cached as well, since most
+ * lookups probe search paths where the header does not exist.
+ */
+class StatCacheTable {
+public:
+  StatCacheTable();
+  ~StatCacheTable();
+
+  // Returns false if path has not been looked up yet.
+  bool lookup(const std::string &path, bool &exists, struct stat &st) const;
+  void insert(const std::string &path, bool exists, const struct stat &st);
+
+  // Forgets what is known about the given files, e.g. after they were
+  // changed, under whatever path they were looked up.  Users holding on
+  // to file system state should drop it when the generation changes.
+  void remove(const std::set<std::string> &fileNames);
+  unsigned long getGeneration() const;
+
+private:
+  struct Entry {
+    bool exists;
+    struct stat st;
+  };
+
+  mutable pthread_rwlock_t _lock;
+  std::map<std::string, Entry> _entries;
+  unsigned long _generation;
+
+  StatCacheTable(const StatCacheTable &);
+  StatCacheTable &operator=(const StatCacheTable &);
+};
+
+/*
+ * Plugs a StatCacheTable into a clang::FileManager, which takes
+ * ownership of this adapter but not of the table.  Clang 3.3 has no
+ * virtual file system layer, so this is the one hook into its lookups.
+ */
+class SharedStatCache : public clang::FileSystemStatCache {
+public:
+  explicit SharedStatCache(StatCacheTable *table);
+
+protected:
+  virtual LookupResult getStat(const char *path, struct stat &statBuf, int *fileDescriptor);
+
+private:
+  StatCacheTable *_table;
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_StatCache_h__ */
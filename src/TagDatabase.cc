@@ -0,0 +1,210 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "TagDatabase.h"
+
+namespace objctags {
+
+namespace {
+
+// Calls back with the name of every line of a formatted chunk.
+template <typename Callback>
+void forEachName(const std::string &chunk, Callback &callback)
+{
+  size_t begin = 0;
+  while (begin < chunk.size()) {
+    size_t end = chunk.find('\n', begin);
+    if (end == std::string::npos) {
+      end = chunk.size();
+    }
+    size_t tab = chunk.find('\t', begin);
+    if (tab != std::string::npos && tab < end) {
+      callback(chunk.substr(begin, tab - begin), begin, end);
+    }
+    begin = end + 1;
+  }
+}
+
+class NameIndexer {
+public:
+  NameIndexer(std::map<std::string, std::set<std::string> > *names, const std::string *sourceFile, bool insert) :
+    _names(names),
+    _sourceFile(sourceFile),
+    _insert(insert)
+  {
+  }
+
+  void operator()(const std::string &name, size_t begin, size_t end)
+  {
+    if (_insert) {
+      (*_names)[name].insert(*_sourceFile);
+      return;
+    }
+
+    std::map<std::string, std::set<std::string> >::iterator it = _names->find(name);
+    if (it != _names->end()) {
+      it->second.erase(*_sourceFile);
+      if (it->second.empty()) {
+        _names->erase(it);
+      }
+    }
+  }
+
+private:
+  std::map<std::string, std::set<std::string> > *_names;
+  const std::string *_sourceFile;
+  bool _insert;
+};
+
+class LineCollector {
+public:
+  LineCollector(const std::string *name, const std::string *chunk, std::string *result) :
+    _name(name),
+    _chunk(chunk),
+    _result(result)
+  {
+  }
+
+  void operator()(const std::string &name, size_t begin, size_t end)
+  {
+    if (name == *_name) {
+      _result->append(*_chunk, begin, end - begin);
+      *_result += "\n";
+    }
+  }
+
+private:
+  const std::string *_name;
+  const std::string *_chunk;
+  std::string *_result;
+};
+
+} // end namespace
+
+TagDatabase::TagDatabase() :
+  _generation(0)
+{
+  pthread_rwlock_init(&_lock, NULL);
+}
+
+TagDatabase::~TagDatabase()
+{
+  pthread_rwlock_destroy(&_lock);
+}
+
+void TagDatabase::update(const std::string &sourceFile, std::string &chunk, unsigned long generation)
+{
+  pthread_rwlock_wrlock(&_lock);
+  // Removals are remembered for good, as a slow worker may still be
+  // tagging the file as it was before, however often it was created again.
+  std::map<std::string, unsigned long>::const_iterator removed = _removed.find(sourceFile);
+  if (removed != _removed.end() && removed->second > generation) {
+    chunk.clear();
+    pthread_rwlock_unlock(&_lock);
+    return;
+  }
+
+  std::string &stored = _chunks[sourceFile];
+  _unindex(sourceFile, stored);
+  stored.swap(chunk);
+  chunk.clear();
+  _index(sourceFile, stored);
+  _generation++;
+  pthread_rwlock_unlock(&_lock);
+}
+
+void TagDatabase::remove(const std::string &sourceFile)
+{
+  pthread_rwlock_wrlock(&_lock);
+  std::map<std::string, std::string>::iterator it = _chunks.find(sourceFile);
+  if (it != _chunks.end()) {
+    _unindex(sourceFile, it->second);
+    _chunks.erase(it);
+  }
+  // Even without tags yet, a worker may be tagging the file.
+  _removed[sourceFile] = ++_generation;
+  pthread_rwlock_unlock(&_lock);
+}
+
+void TagDatabase::lookup(const std::string &name, std::string &result) const
+{
+  pthread_rwlock_rdlock(&_lock);
+  std::map<std::string, std::set<std::string> >::const_iterator it = _names.find(name);
+  if (it != _names.end()) {
+    for (std::set<std::string>::const_iterator file = it->second.begin(); file != it->second.end(); file++) {
+      std::map<std::string, std::string>::const_iterator chunk = _chunks.find(*file);
+      if (chunk != _chunks.end()) {
+        LineCollector collector(&name, &chunk->second, &result);
+        forEachName(chunk->second, collector);
+      }
+    }
+  }
+  pthread_rwlock_unlock(&_lock);
+}
+
+bool TagDatabase::write(TagWriter &tagWriter) const
+{
+  bool success = true;
+  pthread_rwlock_rdlock(&_lock);
+  for (std::map<std::string, std::string>::const_iterator it = _chunks.begin(); it != _chunks.end(); it++) {
+    std::string chunk = it->second;
+    success = tagWriter.write(chunk) && success;
+  }
+  pthread_rwlock_unlock(&_lock);
+  return success;
+}
+
+bool TagDatabase::write(TagSorter &tagSorter) const
+{
+  bool success = true;
+  pthread_rwlock_rdlock(&_lock);
+  for (std::map<std::string, std::string>::const_iterator it = _chunks.begin(); it != _chunks.end(); it++) {
+    std::string chunk = it->second;
+    success = tagSorter.add(chunk) && success;
+  }
+  pthread_rwlock_unlock(&_lock);
+  return success;
+}
+
+unsigned long TagDatabase::getGeneration() const
+{
+  pthread_rwlock_rdlock(&_lock);
+  unsigned long generation = _generation;
+  pthread_rwlock_unlock(&_lock);
+  return generation;
+}
+
+void TagDatabase::_unindex(const std::string &sourceFile, const std::string &chunk)
+{
+  NameIndexer indexer(&_names, &sourceFile, false);
+  forEachName(chunk, indexer);
+}
+
+void TagDatabase::_index(const std::string &sourceFile, const std::string &chunk)
+{
+  NameIndexer indexer(&_names, &sourceFile, true);
+  forEachName(chunk, indexer);
+}
+
+} // end namespace objctags
@@ -0,0 +1,78 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_TagDatabase_h__
+#define __objctags_TagDatabase_h__
+
+#include <pthread.h>
+#include <map>
+#include <set>
+#include <string>
+#include "TagSorter.h"
+#include "TagWriter.h"
+
+namespace objctags {
+
+/*
+ * The formatted tags of every source file, kept in memory by the daemon
+ * and indexed by tag name.  Workers replace the tags of a file as they
+ * re-tag it while lookups are being served.
+ */
+class TagDatabase {
+public:
+  TagDatabase();
+  ~TagDatabase();
+
+  // Takes over the contents of chunk, leaving it empty.  generation is
+  // what getGeneration() returned before sourceFile was read; if the
+  // file was removed since, its tags are dropped instead.
+  void update(const std::string &sourceFile, std::string &chunk, unsigned long generation);
+  void remove(const std::string &sourceFile);
+
+  // Appends the tag lines named name to result.
+  void lookup(const std::string &name, std::string &result) const;
+  bool write(TagWriter &tagWriter) const;
+  bool write(TagSorter &tagSorter) const;
+
+  // Increases with every change.
+  unsigned long getGeneration() const;
+
+private:
+  mutable pthread_rwlock_t _lock;
+  std::map<std::string, std::string> _chunks;
+  std::map<std::string, std::set<std::string> > _names;
+  // The generation each file was last removed in.
+  std::map<std::string, unsigned long> _removed;
+  unsigned long _generation;
+
+  void _unindex(const std::string &sourceFile, const std::string &chunk);
+  void _index(const std::string &sourceFile, const std::string &chunk);
+
+  TagDatabase(const TagDatabase &);
+  TagDatabase &operator=(const TagDatabase &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_TagDatabase_h__ */
@@ -0,0 +1,157 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "TagFile.h"
+
+namespace objctags {
+
+TagFileReader::TagFileReader() :
+  _fp(NULL),
+  _sorted(-1),
+  _buffer(NULL),
+  _capacity(0),
+  _files(NULL),
+  _include(false)
+{
+}
+
+TagFileReader::~TagFileReader()
+{
+  close();
+  free(_buffer);
+}
+
+bool TagFileReader::open(const std::string &fileName)
+{
+  close();
+  _fp = fopen(fileName.c_str(), "r");
+  if (_fp == NULL) {
+    return false;
+  }
+  _readHeader();
+  return true;
+}
+
+void TagFileReader::attach(FILE *fp)
+{
+  close();
+  _fp = fp;
+  _readHeader();
+}
+
+// The pseudo-tags come first; reading stops right before the first tag.
+void TagFileReader::_readHeader()
+{
+  _sorted = -1;
+  while (true) {
+    long offset = ftell(_fp);
+    ssize_t length = getline(&_buffer, &_capacity, _fp);
+    if (length < 0) {
+      return;
+    }
+    if (strncmp(_buffer, "!_TAG_", 6) != 0) {
+      fseek(_fp, offset, SEEK_SET);
+      return;
+    }
+    if (strncmp(_buffer, "!_TAG_FILE_SORTED\t", 18) == 0) {
+      _sorted = atoi(_buffer + 18);
+    }
+  }
+}
+
+void TagFileReader::setFileFilter(const std::set<std::string> *files, bool include)
+{
+  _files = files;
+  _include = include;
+}
+
+void TagFileReader::close()
+{
+  if (_fp != NULL) {
+    fclose(_fp);
+    _fp = NULL;
+  }
+}
+
+bool TagFileReader::next(std::string &line)
+{
+  if (_fp == NULL) {
+    return false;
+  }
+
+  while (true) {
+    ssize_t length = getline(&_buffer, &_capacity, _fp);
+    if (length < 0) {
+      return false;
+    }
+
+    while (length > 0 && (_buffer[length - 1] == '\n' || _buffer[length - 1] == '\r')) {
+      length--;
+    }
+    if (length == 0) {
+      continue;
+    }
+    if (strncmp(_buffer, "!_TAG_", 6) == 0) {
+      continue;
+    }
+
+    if (_files != NULL) {
+      const char *file = static_cast<const char *>(memchr(_buffer, '\t', length));
+      const char *fileEnd = (file != NULL) ? static_cast<const char *>(memchr(file + 1, '\t', _buffer + length - file - 1)) : NULL;
+      if (fileEnd == NULL) {
+        continue;
+      }
+      bool found = _files->find(std::string(file + 1, fileEnd)) != _files->end();
+      if (found != _include) {
+        continue;
+      }
+    }
+
+    line.assign(_buffer, static_cast<size_t>(length));
+    return true;
+  }
+}
+
+std::string getTagField(const std::string &line, size_t index)
+{
+  size_t begin = 0;
+  for (size_t i = 0; i < index; i++) {
+    begin = line.find('\t', begin);
+    if (begin == std::string::npos) {
+      return "";
+    }
+    begin++;
+  }
+
+  size_t end = line.find('\t', begin);
+  if (end == std::string::npos) {
+    end = line.size();
+  }
+  return line.substr(begin, end - begin);
+}
+
+} // end namespace objctags
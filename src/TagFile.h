@@ -0,0 +1,81 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_TagFile_h__
+#define __objctags_TagFile_h__
+
+#include <stdio.h>
+#include <set>
+#include <string>
+
+namespace objctags {
+
+/*
+ * Reads an existing tags file one tag line at a time, skipping the
+ * '!_TAG_' pseudo-tags written by TagFormatter::header().
+ */
+class TagFileReader {
+public:
+  TagFileReader();
+  ~TagFileReader();
+
+  bool open(const std::string &fileName);
+  // Reads from fp, which is closed by close().
+  void attach(FILE *fp);
+  void close();
+
+  // Only returns the lines whose file is in files if include is set,
+  // or is not otherwise.  files has to outlive the reader.
+  void setFileFilter(const std::set<std::string> *files, bool include);
+
+  // The line is returned without its trailing newline.
+  bool next(std::string &line);
+
+  // The value of the '!_TAG_FILE_SORTED' pseudo-tag, or -1 if there is
+  // none.
+  int getSorted() const { return _sorted; }
+
+private:
+  FILE *_fp;
+  int _sorted;
+  char *_buffer;
+  size_t _capacity;
+  const std::set<std::string> *_files;
+  bool _include;
+
+  void _readHeader();
+
+  TagFileReader(const TagFileReader &);
+  TagFileReader &operator=(const TagFileReader &);
+};
+
+// Returns the index-th tab-separated field of a tag line.
+std::string getTagField(const std::string &line, size_t index);
+
+static const size_t tagfield_name = 0;
+static const size_t tagfield_file = 1;
+
+} // end namespace objctags
+
+#endif /* __objctags_TagFile_h__ */
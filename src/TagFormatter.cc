@@ -22,16 +22,17 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <sstream>
 #include "TagFormatter.h"
 #include "Defines.h"
 
 namespace objctags {
 
-std::string TagFormatter::header()
+std::string TagFormatter::header(SortOrder order)
 {
   std::ostringstream os;
   os << "!_TAG_FILE_FORMAT\t2\t/extended format/\n";
-  os << "!_TAG_FILE_SORTED\t0\t/0=unsorted, 1=sorted, 2=foldcase/\n";
+  os << "!_TAG_FILE_SORTED\t" << static_cast<int>(order) << "\t/0=unsorted, 1=sorted, 2=foldcase/\n";
   os << "!_TAG_PROGRAM_AUTHOR\t" << OBJCTAGS_PROGRAM_AUTHOR << "\n";
   os << "!_TAG_PROGRAM_NAME\t" << OBJCTAGS_PROGRAM_NAME << "\n";
   os << "!_TAG_PROGRAM_URL\t" << OBJCTAGS_PROGRAM_URL << "\n";
@@ -39,14 +40,25 @@ std::string TagFormatter::header()
   return os.str();
 }
 
-void TagFormatter::merge(const TagInfoVector &tagInfoVector)
+void TagFormatter::format(const TagInfoVector &tagInfoVector, std::string &chunk, TagSet *seen)
 {
-  for (TagInfoConstIterator it = tagInfoVector.begin(); it != tagInfoVector.end(); it++) {
-    _stream << it->name << "\t"
-            << it->file << "\t"
-            << "/^" << it->line << "$/;\"\t"
-            << it->kind << "\t"
-            << it->scope << "\n";
+  for (size_t i = 0; i < tagInfoVector.size(); i++) {
+    const TagInfo &tag = tagInfoVector[i];
+    size_t beginOfLine = chunk.size();
+    chunk.append(tagInfoVector.getName(tag), tag.nameLength);
+    chunk += "\t";
+    chunk += tagInfoVector.getString(tag.file);
+    chunk += "\t/^";
+    chunk.append(tagInfoVector.getLine(tag), tag.lineLength);
+    chunk += "$/;\"\t";
+    chunk += tag.kind;
+    chunk += "\t";
+    chunk += tagInfoVector.getString(tag.scope);
+    if (seen != NULL && !seen->insert(chunk.data() + beginOfLine, chunk.size() - beginOfLine)) {
+      chunk.resize(beginOfLine);
+      continue;
+    }
+    chunk += "\n";
   }
 }
 
@@ -25,23 +25,19 @@
 #ifndef __objctags_TagFormatter_h__
 #define __objctags_TagFormatter_h__
 
-#include <sstream>
+#include <string>
 #include "TagInfo.h"
+#include "TagSet.h"
+#include "TagSorter.h"
 
 namespace objctags {
 
 class TagFormatter {
 public:
-  static std::string header();
-  void merge(const TagInfoVector &tagInfoVector);
-
-  std::string str() const
-  {
-    return header() + _stream.str();
-  }
-
-private:
-  std::ostringstream _stream;
+  static std::string header(SortOrder order);
+  // If seen is given, lines already in it are left out, and the others
+  // are added to it.
+  static void format(const TagInfoVector &tagInfoVector, std::string &chunk, TagSet *seen = NULL);
 };
 
 } // end namespace objctags
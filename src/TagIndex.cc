@@ -0,0 +1,351 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "TagFile.h"
+#include "TagIndex.h"
+
+namespace objctags {
+
+namespace {
+
+const char indexMagic[8] = {'O', 'B', 'J', 'C', 'T', 'A', 'G', 'X'};
+const uint32_t indexVersion = 1;
+
+// Names, files and fields repeat a lot and are interned; addresses are
+// mostly distinct, and only shared by the tags of one line.
+class StringTable {
+public:
+  StringTable() : _lastAddress(0), _hasLastAddress(false)
+  {
+    _ids[std::string()] = _append(std::string());
+  }
+
+  uint32_t intern(const std::string &string)
+  {
+    std::map<std::string, uint32_t>::iterator it = _ids.find(string);
+    if (it == _ids.end()) {
+      it = _ids.insert(std::make_pair(string, _append(string))).first;
+    }
+    return it->second;
+  }
+
+  uint32_t addAddress(const std::string &address)
+  {
+    if (!_hasLastAddress || address != _data.c_str() + _lastAddress) {
+      _lastAddress = _append(address);
+      _hasLastAddress = true;
+    }
+    return _lastAddress;
+  }
+
+  const std::string &data() const { return _data; }
+
+private:
+  std::string _data;
+  std::map<std::string, uint32_t> _ids;
+  uint32_t _lastAddress;
+  bool _hasLastAddress;
+
+  uint32_t _append(const std::string &string)
+  {
+    uint32_t offset = static_cast<uint32_t>(_data.size());
+    _data += string;
+    _data += '\0';
+    return offset;
+  }
+};
+
+struct IndexEntry {
+  uint32_t name;
+  TagIndexRecord record;
+};
+
+struct IndexEntryLess {
+  const char *strings;
+
+  explicit IndexEntryLess(const char *strings) : strings(strings) {}
+  bool operator()(const IndexEntry &a, const IndexEntry &b) const
+  {
+    return a.name != b.name && strcmp(strings + a.name, strings + b.name) < 0;
+  }
+};
+
+// Splits 'name<TAB>file<TAB>address<TAB>kind<TAB>scope'.  The address
+// may contain tabs itself, so the fields are taken from the end.
+bool splitTagLine(const std::string &line, std::string &name, std::string &file,
+                  std::string &address, std::string &fields)
+{
+  size_t nameEnd = line.find('\t');
+  if (nameEnd == std::string::npos) {
+    return false;
+  }
+  size_t fileEnd = line.find('\t', nameEnd + 1);
+  if (fileEnd == std::string::npos) {
+    return false;
+  }
+  size_t scopeBegin = line.rfind('\t');
+  size_t fieldsBegin = (scopeBegin > fileEnd) ? line.rfind('\t', scopeBegin - 1) : std::string::npos;
+
+  name.assign(line, 0, nameEnd);
+  file.assign(line, nameEnd + 1, fileEnd - nameEnd - 1);
+  if (fieldsBegin == std::string::npos || fieldsBegin <= fileEnd) {
+    address.assign(line, fileEnd + 1, std::string::npos);
+    fields.clear();
+  }
+  else {
+    address.assign(line, fileEnd + 1, fieldsBegin - fileEnd - 1);
+    fields.assign(line, fieldsBegin + 1, std::string::npos);
+  }
+  return true;
+}
+
+} // end namespace
+
+bool writeTagIndex(const std::string &tagFileName, const std::string &indexFileName)
+{
+  TagFileReader reader;
+  if (!reader.open(tagFileName)) {
+    return false;
+  }
+
+  StringTable strings;
+  std::vector<IndexEntry> entries;
+  std::string line, name, file, address, fields;
+  while (reader.next(line)) {
+    if (!splitTagLine(line, name, file, address, fields)) {
+      continue;
+    }
+    IndexEntry entry;
+    entry.name = strings.intern(name);
+    entry.record.file = strings.intern(file);
+    entry.record.address = strings.addAddress(address);
+    entry.record.fields = strings.intern(fields);
+    entries.push_back(entry);
+  }
+  reader.close();
+
+  // Offsets are 32 bits wide.
+  if (strings.data().size() > 0xffffffffUL || entries.size() > 0xffffffffUL) {
+    return false;
+  }
+
+  // Already in order if the tags file is sorted by bytes.
+  std::stable_sort(entries.begin(), entries.end(), IndexEntryLess(strings.data().c_str()));
+
+  std::vector<TagIndexName> names;
+  std::vector<TagIndexRecord> tags;
+  tags.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (names.empty() || names.back().name != entries[i].name) {
+      TagIndexName indexName;
+      indexName.name = entries[i].name;
+      indexName.firstTag = static_cast<uint32_t>(i);
+      indexName.tagCount = 0;
+      names.push_back(indexName);
+    }
+    names.back().tagCount++;
+    tags.push_back(entries[i].record);
+  }
+  std::vector<IndexEntry>().swap(entries);
+
+  TagIndexHeader header;
+  memcpy(header.magic, indexMagic, sizeof(header.magic));
+  header.version = indexVersion;
+  header.nameCount = static_cast<uint32_t>(names.size());
+  header.tagCount = static_cast<uint32_t>(tags.size());
+  header.stringsSize = static_cast<uint32_t>(strings.data().size());
+
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".tmp.%ld", static_cast<long>(getpid()));
+  std::string tempFileName = indexFileName + suffix;
+  FILE *fp = fopen(tempFileName.c_str(), "wb");
+  if (fp == NULL) {
+    return false;
+  }
+
+  bool success = fwrite(&header, sizeof(header), 1, fp) == 1;
+  if (!names.empty()) {
+    success = success && fwrite(&names[0], sizeof(TagIndexName), names.size(), fp) == names.size();
+  }
+  if (!tags.empty()) {
+    success = success && fwrite(&tags[0], sizeof(TagIndexRecord), tags.size(), fp) == tags.size();
+  }
+  success = success && fwrite(strings.data().data(), 1, strings.data().size(), fp) == strings.data().size();
+  success = (fclose(fp) == 0) && success;
+
+  if (!success || rename(tempFileName.c_str(), indexFileName.c_str()) != 0) {
+    unlink(tempFileName.c_str());
+    return false;
+  }
+  return true;
+}
+
+TagIndex::TagIndex() :
+  _data(NULL),
+  _size(0),
+  _names(NULL),
+  _tags(NULL),
+  _strings(NULL),
+  _nameCount(0)
+{
+}
+
+TagIndex::~TagIndex()
+{
+  close();
+}
+
+bool TagIndex::open(const std::string &fileName)
+{
+  close();
+
+  int fd = ::open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(TagIndexHeader)) {
+    ::close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  _data = data;
+  _size = static_cast<size_t>(st.st_size);
+
+  // The strings have to end with a null character, so that the last one
+  // does not run past the mapping.
+  const TagIndexHeader *header = static_cast<const TagIndexHeader *>(_data);
+  size_t namesSize = static_cast<size_t>(header->nameCount) * sizeof(TagIndexName);
+  size_t tagsSize = static_cast<size_t>(header->tagCount) * sizeof(TagIndexRecord);
+  if (memcmp(header->magic, indexMagic, sizeof(indexMagic)) != 0 ||
+      header->version != indexVersion ||
+      header->stringsSize == 0 ||
+      sizeof(TagIndexHeader) + namesSize + tagsSize + header->stringsSize != _size ||
+      static_cast<const char *>(_data)[_size - 1] != '\0') {
+    close();
+    return false;
+  }
+
+  const char *p = static_cast<const char *>(_data) + sizeof(TagIndexHeader);
+  _names = reinterpret_cast<const TagIndexName *>(p);
+  _tags = reinterpret_cast<const TagIndexRecord *>(p + namesSize);
+  _strings = p + namesSize + tagsSize;
+  _nameCount = header->nameCount;
+  return true;
+}
+
+void TagIndex::close()
+{
+  if (_data != NULL) {
+    munmap(_data, _size);
+    _data = NULL;
+    _size = 0;
+  }
+  _names = NULL;
+  _tags = NULL;
+  _strings = NULL;
+  _nameCount = 0;
+}
+
+const TagIndexName *TagIndex::_lowerBound(const std::string &name) const
+{
+  size_t low = 0;
+  size_t high = _nameCount;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (strcmp(_strings + _names[middle].name, name.c_str()) < 0) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  return _names + low;
+}
+
+size_t TagIndex::_append(const TagIndexName &name, std::string &result) const
+{
+  for (uint32_t i = 0; i < name.tagCount; i++) {
+    const TagIndexRecord &tag = _tags[name.firstTag + i];
+    result += _strings + name.name;
+    result += '\t';
+    result += _strings + tag.file;
+    result += '\t';
+    result += _strings + tag.address;
+    if (_strings[tag.fields] != '\0') {
+      result += '\t';
+      result += _strings + tag.fields;
+    }
+    result += '\n';
+  }
+  return name.tagCount;
+}
+
+size_t TagIndex::lookup(const std::string &name, std::string &result) const
+{
+  if (_data == NULL) {
+    return 0;
+  }
+  const TagIndexName *it = _lowerBound(name);
+  if (it == _names + _nameCount || name != _strings + it->name) {
+    return 0;
+  }
+  return _append(*it, result);
+}
+
+size_t TagIndex::lookupPrefix(const std::string &prefix, std::string &result) const
+{
+  if (_data == NULL) {
+    return 0;
+  }
+  size_t count = 0;
+  for (const TagIndexName *it = _lowerBound(prefix); it != _names + _nameCount; it++) {
+    if (strncmp(_strings + it->name, prefix.c_str(), prefix.size()) != 0) {
+      break;
+    }
+    count += _append(*it, result);
+  }
+  return count;
+}
+
+std::string getIndexFileName(const std::string &tagFileName)
+{
+  return tagFileName + ".index";
+}
+
+} // end namespace objctags
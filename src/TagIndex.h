@@ -0,0 +1,96 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __objctags_TagIndex_h__
+#define __objctags_TagIndex_h__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace objctags {
+
+/*
+ * A binary index of a tags file, meant to be mapped and searched as is.
+ * In native byte order, it holds a header, the distinct tag names sorted
+ * by bytes, each with the range of its tag records, the fixed-size tag
+ * records, and a table of null-terminated strings they all point into.
+ */
+struct TagIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t nameCount;
+  uint32_t tagCount;
+  uint32_t stringsSize;
+};
+
+struct TagIndexName {
+  uint32_t name;
+  uint32_t firstTag;
+  uint32_t tagCount;
+};
+
+// A tag line is its name, file, address and fields joined by tabs.
+struct TagIndexRecord {
+  uint32_t file;
+  uint32_t address;
+  uint32_t fields;
+};
+
+// Builds the index of the tags file tagFileName.
+bool writeTagIndex(const std::string &tagFileName, const std::string &indexFileName);
+
+class TagIndex {
+public:
+  TagIndex();
+  ~TagIndex();
+
+  bool open(const std::string &fileName);
+  void close();
+
+  // Append the matching tag lines to result and return their number.
+  size_t lookup(const std::string &name, std::string &result) const;
+  size_t lookupPrefix(const std::string &prefix, std::string &result) const;
+
+private:
+  void *_data;
+  size_t _size;
+  const TagIndexName *_names;
+  const TagIndexRecord *_tags;
+  const char *_strings;
+  uint32_t _nameCount;
+
+  const TagIndexName *_lowerBound(const std::string &name) const;
+  size_t _append(const TagIndexName &name, std::string &result) const;
+
+  TagIndex(const TagIndex &);
+  TagIndex &operator=(const TagIndex &);
+};
+
+std::string getIndexFileName(const std::string &tagFileName);
+
+} // end namespace objctags
+
+#endif /* __objctags_TagIndex_h__ */
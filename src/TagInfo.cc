@@ -22,10 +22,167 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <string.h>
 #include "TagInfo.h"
+#include "Hash.h"
 
 namespace objctags {
 
+namespace {
+
+const uint32_t emptyBucket = 0xffffffff;
+
+} // end namespace
+
+TagInfoVector::TagInfoVector() :
+  _source(NULL),
+  _sourceLength(0),
+  _lastFile(0),
+  _lastScope(0)
+{
+}
+
+void TagInfoVector::setSource(const char *source, size_t length)
+{
+  _source = source;
+  _sourceLength = length;
+}
+
+// Tags come in runs of the same file and scope, so the last ones are
+// tried before the table, and a key is only built to look that up.
+uint32_t TagInfoVector::_intern(const char *data, size_t length, uint32_t &last)
+{
+  if (last < _strings.size() && _strings[last].size() == length &&
+      memcmp(_strings[last].data(), data, length) == 0) {
+    return last;
+  }
+
+  std::string string(data, length);
+  std::map<std::string, uint32_t>::iterator it = _stringIDs.find(string);
+  if (it == _stringIDs.end()) {
+    it = _stringIDs.insert(std::make_pair(string, static_cast<uint32_t>(_strings.size()))).first;
+    _strings.push_back(string);
+  }
+  last = it->second;
+  return last;
+}
+
+void TagInfoVector::add(const char *name, size_t nameLength,
+                        const char *file, size_t fileLength,
+                        const char *line, size_t lineLength,
+                        char kind,
+                        const char *scope, size_t scopeLength)
+{
+  TagInfo tag;
+  tag.name = static_cast<uint32_t>(_arena.size());
+  tag.nameLength = static_cast<uint32_t>(nameLength);
+  _arena.append(name, nameLength);
+
+  if (_source != NULL && line >= _source && line + lineLength <= _source + _sourceLength) {
+    tag.line = static_cast<uint32_t>(line - _source);
+    tag.lineInArena = false;
+  }
+  else {
+    tag.line = static_cast<uint32_t>(_arena.size());
+    tag.lineInArena = true;
+    _arena.append(line, lineLength);
+  }
+  tag.lineLength = static_cast<uint32_t>(lineLength);
+
+  tag.file = _intern(file, fileLength, _lastFile);
+  tag.scope = _intern(scope, scopeLength, _lastScope);
+  tag.kind = kind;
+  _tags.push_back(tag);
+}
+
+bool TagInfoVector::_isEqual(const TagInfo &a, const TagInfo &b) const
+{
+  return a.kind == b.kind && a.file == b.file && a.scope == b.scope &&
+         a.nameLength == b.nameLength && a.lineLength == b.lineLength &&
+         memcmp(getName(a), getName(b), a.nameLength) == 0 &&
+         memcmp(getLine(a), getLine(b), a.lineLength) == 0;
+}
+
+uint64_t TagInfoVector::_hash(const TagInfo &tag) const
+{
+  uint64_t hash = hashBytes(getName(tag), tag.nameLength);
+  hash = hashBytes(getLine(tag), tag.lineLength, hash);
+  uint32_t fields[] = {tag.file, tag.scope, static_cast<uint32_t>(tag.kind)};
+  return hashBytes(reinterpret_cast<const char *>(fields), sizeof(fields), hash);
+}
+
+// Redeclarations, and declarations repeated in the branches of a
+// conditional, are not necessarily adjacent, so the tags kept so far are
+// looked up in a hash table by index.
+void TagInfoVector::unique()
+{
+  size_t bucketCount = 16;
+  while (bucketCount < _tags.size() * 2) {
+    bucketCount *= 2;
+  }
+  std::vector<uint32_t> buckets(bucketCount, emptyBucket);
+  size_t mask = bucketCount - 1;
+
+  size_t count = 0;
+  for (size_t i = 0; i < _tags.size(); i++) {
+    size_t index = static_cast<size_t>(_hash(_tags[i])) & mask;
+    bool duplicate = false;
+    while (buckets[index] != emptyBucket) {
+      if (_isEqual(_tags[buckets[index]], _tags[i])) {
+        duplicate = true;
+        break;
+      }
+      index = (index + 1) & mask;
+    }
+    if (!duplicate) {
+      buckets[index] = static_cast<uint32_t>(count);
+      _tags[count++] = _tags[i];
+    }
+  }
+  _tags.resize(count);
+}
+
+void TagInfoVector::clear()
+{
+  _arena.clear();
+  _tags.clear();
+  _strings.clear();
+  _stringIDs.clear();
+  _lastFile = 0;
+  _lastScope = 0;
+}
+
+size_t TagInfoVector::getSourceEnd() const
+{
+  size_t end = 0;
+  for (size_t i = 0; i < _tags.size(); i++) {
+    if (!_tags[i].lineInArena && _tags[i].line + _tags[i].lineLength > end) {
+      end = _tags[i].line + _tags[i].lineLength;
+    }
+  }
+  return end;
+}
+
+size_t TagInfoVector::append(const TagInfoVector &other, size_t offset)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < other.size(); i++) {
+    const TagInfo &tag = other[i];
+    if (tag.lineInArena || tag.line < offset) {
+      continue;
+    }
+    const std::string &file = other.getString(tag.file);
+    const std::string &scope = other.getString(tag.scope);
+    add(other.getName(tag), tag.nameLength,
+        file.data(), file.size(),
+        other.getLine(tag), tag.lineLength,
+        tag.kind,
+        scope.data(), scope.size());
+    count++;
+  }
+  return count;
+}
+
 std::string getTagKindScopedName(const char tagkind)
 {
   switch (tagkind) {
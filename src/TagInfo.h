@@ -25,33 +25,91 @@
 #ifndef __objctags_TagInfo_h__
 #define __objctags_TagInfo_h__
 
+#include <stdint.h>
+#include <map>
 #include <string>
 #include <vector>
 
 namespace objctags {
 
+// The fields are resolved through the TagInfoVector holding the tag.
 struct TagInfo {
-  std::string name;
-  std::string file;
-  std::string line;
+  uint32_t name;        // offset into the arena
+  uint32_t nameLength;
+  uint32_t line;        // offset into the source, or the arena if lineInArena
+  uint32_t lineLength;
+  uint32_t file;        // interned
+  uint32_t scope;       // interned
   char kind;
-  std::string scope;
+  bool lineInArena;
+};
+
+/*
+ * The tags of one translation unit.  Files and scopes are interned, names
+ * are kept in a single arena, and lines are referenced in the source of
+ * the main file rather than copied, so adding a tag allocates nothing of
+ * its own.  The source has to outlive the vector.
+ */
+class TagInfoVector {
+public:
+  TagInfoVector();
+
+  // Lines within [source, source + length) are referenced, others copied.
+  void setSource(const char *source, size_t length);
 
-  bool operator==(const TagInfo &tagInfo)
+  // Nothing needs to be a std::string, so callers can pass the names
+  // and files clang keeps, as they are.
+  void add(const char *name, size_t nameLength,
+           const char *file, size_t fileLength,
+           const char *line, size_t lineLength,
+           char kind,
+           const char *scope, size_t scopeLength);
+  void add(const std::string &name,
+           const std::string &file,
+           const char *line, size_t lineLength,
+           char kind,
+           const std::string &scope)
   {
-    return name == tagInfo.name && file == tagInfo.file &&
-           line == tagInfo.line && kind == tagInfo.kind &&
-           scope == tagInfo.scope;
+    add(name.data(), name.size(), file.data(), file.size(), line, lineLength, kind, scope.data(), scope.size());
   }
 
-  bool operator!=(const TagInfo &tagInfo)
+  // Drops tags equal to an earlier one, keeping the order of the rest.
+  void unique();
+  // Drops the tags, but keeps the source.
+  void clear();
+
+  // The offset just past the last line of the source a tag refers to, or
+  // 0 if none does.
+  size_t getSourceEnd() const;
+  // Adds the tags of other, which shares the source, whose line starts at
+  // offset or later.  Returns how many were added.
+  size_t append(const TagInfoVector &other, size_t offset);
+
+  size_t size() const { return _tags.size(); }
+  bool empty() const { return _tags.empty(); }
+  const TagInfo &operator[](size_t index) const { return _tags[index]; }
+
+  const char *getName(const TagInfo &tag) const { return _arena.data() + tag.name; }
+  const char *getLine(const TagInfo &tag) const
   {
-    return !operator==(tagInfo);
+    return tag.lineInArena ? _arena.data() + tag.line : _source + tag.line;
   }
+  const std::string &getString(uint32_t id) const { return _strings[id]; }
+
+private:
+  const char *_source;
+  size_t _sourceLength;
+  std::string _arena;
+  std::vector<TagInfo> _tags;
+  std::vector<std::string> _strings;
+  std::map<std::string, uint32_t> _stringIDs;
+  uint32_t _lastFile;
+  uint32_t _lastScope;
+
+  uint32_t _intern(const char *data, size_t length, uint32_t &last);
+  uint64_t _hash(const TagInfo &tag) const;
+  bool _isEqual(const TagInfo &a, const TagInfo &b) const;
 };
-typedef std::vector<TagInfo> TagInfoVector;
-typedef TagInfoVector::iterator TagInfoIterator;
-typedef TagInfoVector::const_iterator TagInfoConstIterator;
 
 std::string getTagKindScopedName(const char tagkind);
 std::string getTagKindLongName(const char tagkind);
@@ -0,0 +1,84 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "TagMerger.h"
+
+namespace objctags {
+
+// Ties go to the earlier reader, so equal lines keep the order of the
+// files they come from.
+bool TagMerger::HeadGreater::operator()(const Head *a, const Head *b) const
+{
+  int result = compareTagLines(a->line.data(), a->line.size(), b->line.data(), b->line.size(), order);
+  return result > 0 || (result == 0 && a->source > b->source);
+}
+
+TagMerger::TagMerger(SortOrder order) :
+  _queue((HeadGreater(order))),
+  _last(NULL)
+{
+}
+
+TagMerger::~TagMerger()
+{
+  for (size_t i = 0; i < _readers.size(); i++) {
+    delete _readers[i];
+    delete _heads[i];
+  }
+}
+
+void TagMerger::add(TagFileReader *reader)
+{
+  Head *head = new Head();
+  head->source = _readers.size();
+  _readers.push_back(reader);
+  _heads.push_back(head);
+  if (reader->next(head->line)) {
+    _queue.push(head);
+  }
+}
+
+bool TagMerger::next(std::string &line, size_t &source)
+{
+  // The reader of the line returned last is only advanced now, as line
+  // was swapped out of its head.
+  if (_last != NULL) {
+    if (_readers[_last->source]->next(_last->line)) {
+      _queue.push(_last);
+    }
+    _last = NULL;
+  }
+  if (_queue.empty()) {
+    return false;
+  }
+
+  _last = _queue.top();
+  _queue.pop();
+  line.swap(_last->line);
+  source = _last->source;
+  return true;
+}
+
+} // end namespace objctags
@@ -0,0 +1,77 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __objctags_TagMerger_h__
+#define __objctags_TagMerger_h__
+
+#include <queue>
+#include <string>
+#include <vector>
+#include "TagFile.h"
+#include "TagSorter.h"
+
+namespace objctags {
+
+/*
+ * Merges tag files sorted in the same order, reading one line ahead in
+ * each of them, so memory use does not depend on their size.  Lines of
+ * files that are not sorted come out in some order, but all of them do.
+ */
+class TagMerger {
+public:
+  explicit TagMerger(SortOrder order);
+  ~TagMerger();
+
+  // Takes ownership of reader, which has to be open.
+  void add(TagFileReader *reader);
+
+  // The next line in order, and the index of the reader it came from.
+  bool next(std::string &line, size_t &source);
+
+private:
+  struct Head {
+    std::string line;
+    size_t source;
+  };
+
+  struct HeadGreater {
+    SortOrder order;
+
+    explicit HeadGreater(SortOrder order) : order(order) {}
+    bool operator()(const Head *a, const Head *b) const;
+  };
+
+  std::vector<TagFileReader *> _readers;
+  std::vector<Head *> _heads;
+  std::priority_queue<Head *, std::vector<Head *>, HeadGreater> _queue;
+  Head *_last;
+
+  TagMerger(const TagMerger &);
+  TagMerger &operator=(const TagMerger &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_TagMerger_h__ */
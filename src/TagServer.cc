@@ -0,0 +1,141 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "TagFormatter.h"
+#include "TagWriter.h"
+#include "TagServer.h"
+
+namespace objctags {
+
+namespace {
+
+const size_t maxRequestSize = 4096;
+
+// A stuck client must not stall the daemon for long.
+const time_t clientTimeout = 5;
+
+} // end namespace
+
+TagServer::TagServer() :
+  _fd(-1)
+{
+}
+
+TagServer::~TagServer()
+{
+  if (_fd >= 0) {
+    close(_fd);
+    unlink(_socketPath.c_str());
+  }
+}
+
+bool TagServer::listen(const std::string &socketPath)
+{
+  struct sockaddr_un addr;
+  if (socketPath.size() >= sizeof(addr.sun_path)) {
+    return false;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+  _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (_fd < 0) {
+    return false;
+  }
+
+  // A socket left behind by a daemon that did not exit cleanly.
+  unlink(socketPath.c_str());
+  if (bind(_fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0 ||
+      ::listen(_fd, 16) != 0) {
+    close(_fd);
+    _fd = -1;
+    return false;
+  }
+
+  _socketPath = socketPath;
+  return true;
+}
+
+int TagServer::getFileDescriptor() const
+{
+  return _fd;
+}
+
+void TagServer::serve(const TagDatabase &database)
+{
+  int client = accept(_fd, NULL, NULL);
+  if (client < 0) {
+    return;
+  }
+
+  struct timeval timeout;
+  timeout.tv_sec = clientTimeout;
+  timeout.tv_usec = 0;
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  std::string request;
+  char buffer[512];
+  while (request.find('\n') == std::string::npos && request.size() < maxRequestSize) {
+    ssize_t length = read(client, buffer, sizeof(buffer));
+    if (length < 0 && errno == EINTR) {
+      continue;
+    }
+    if (length <= 0) {
+      break;
+    }
+    request.append(buffer, static_cast<size_t>(length));
+  }
+  request = request.substr(0, request.find_first_of("\r\n"));
+
+  TagWriter tagWriter;
+  tagWriter.attach(client);
+  if (request.compare(0, 7, "lookup ") == 0) {
+    std::string result;
+    database.lookup(request.substr(7), result);
+    tagWriter.write(result);
+  }
+  else if (request == "tags") {
+    std::string header = TagFormatter::header(sortorder_none);
+    tagWriter.write(header);
+    database.write(tagWriter);
+  }
+  else {
+    std::string error = "unknown request\n";
+    tagWriter.write(error);
+  }
+  tagWriter.close();
+
+  close(client);
+}
+
+} // end namespace objctags
@@ -0,0 +1,62 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_TagServer_h__
+#define __objctags_TagServer_h__
+
+#include <string>
+#include "TagDatabase.h"
+
+namespace objctags {
+
+/*
+ * Answers requests on a Unix domain socket, one request per connection:
+ *
+ *   lookup NAME    the tag lines named NAME
+ *   tags           the whole tags file
+ *
+ * The end of the answer is marked by the server closing the connection.
+ */
+class TagServer {
+public:
+  TagServer();
+  ~TagServer();
+
+  bool listen(const std::string &socketPath);
+  int getFileDescriptor() const;
+
+  // Accepts a pending connection and answers it.
+  void serve(const TagDatabase &database);
+
+private:
+  int _fd;
+  std::string _socketPath;
+
+  TagServer(const TagServer &);
+  TagServer &operator=(const TagServer &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_TagServer_h__ */
@@ -0,0 +1,114 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "TagSet.h"
+#include "Hash.h"
+
+namespace objctags {
+
+namespace {
+
+// A power of two, well above the number of threads.
+const size_t shardCount = 64;
+const size_t initialSlotCount = 1024;
+
+// Mixed so that both the shard (high bits) and the slot (low bits) are
+// taken from well distributed bits.
+uint64_t hashLine(const char *line, size_t length)
+{
+  uint64_t hash = hashBytes(line, length);
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return (hash == 0) ? 1 : hash;
+}
+
+} // end namespace
+
+TagSet::TagSet() :
+  _shards(shardCount)
+{
+  for (size_t i = 0; i < _shards.size(); i++) {
+    pthread_mutex_init(&_shards[i].mutex, NULL);
+    _shards[i].slots.resize(initialSlotCount, 0);
+    _shards[i].count = 0;
+  }
+}
+
+TagSet::~TagSet()
+{
+  for (size_t i = 0; i < _shards.size(); i++) {
+    pthread_mutex_destroy(&_shards[i].mutex);
+  }
+}
+
+bool TagSet::insert(const char *line, size_t length)
+{
+  uint64_t hash = hashLine(line, length);
+  Shard &shard = _shards[hash >> 58];
+
+  pthread_mutex_lock(&shard.mutex);
+  size_t mask = shard.slots.size() - 1;
+  size_t index = static_cast<size_t>(hash) & mask;
+  bool inserted = false;
+  while (true) {
+    if (shard.slots[index] == hash) {
+      break;
+    }
+    if (shard.slots[index] == 0) {
+      shard.slots[index] = hash;
+      inserted = true;
+      // Kept at most half full.
+      if (++shard.count * 2 > shard.slots.size()) {
+        _grow(shard);
+      }
+      break;
+    }
+    index = (index + 1) & mask;
+  }
+  pthread_mutex_unlock(&shard.mutex);
+
+  return inserted;
+}
+
+void TagSet::_grow(Shard &shard)
+{
+  std::vector<uint64_t> slots(shard.slots.size() * 2, 0);
+  size_t mask = slots.size() - 1;
+  for (size_t i = 0; i < shard.slots.size(); i++) {
+    uint64_t hash = shard.slots[i];
+    if (hash == 0) {
+      continue;
+    }
+    size_t index = static_cast<size_t>(hash) & mask;
+    while (slots[index] != 0) {
+      index = (index + 1) & mask;
+    }
+    slots[index] = hash;
+  }
+  shard.slots.swap(slots);
+}
+
+} // end namespace objctags
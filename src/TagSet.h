@@ -0,0 +1,71 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __objctags_TagSet_h__
+#define __objctags_TagSet_h__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace objctags {
+
+/*
+ * The tag lines written so far in a run, shared by all threads so that
+ * a tag found by several translation units is written once.  Only a
+ * 64-bit hash of each line is kept, so a line whose hash collides with
+ * that of an earlier, different one is taken for a duplicate and
+ * dropped.  With n lines that happens with a probability of about
+ * n^2 / 2^65, i.e. never in practice.  The set is split into shards by
+ * hash, each behind its own lock, so threads rarely wait on each other.
+ */
+class TagSet {
+public:
+  TagSet();
+  ~TagSet();
+
+  // Records line, without its newline, and returns whether it is new.
+  bool insert(const char *line, size_t length);
+
+private:
+  struct Shard {
+    pthread_mutex_t mutex;
+    // Open addressing, zero marks an empty slot.
+    std::vector<uint64_t> slots;
+    size_t count;
+  };
+
+  std::vector<Shard> _shards;
+
+  static void _grow(Shard &shard);
+
+  TagSet(const TagSet &);
+  TagSet &operator=(const TagSet &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_TagSet_h__ */
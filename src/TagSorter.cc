@@ -0,0 +1,304 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <ctype.h>
+#include <pthread.h>
+#include <string.h>
+#include <algorithm>
+#include "TagMerger.h"
+#include "TagSorter.h"
+
+namespace objctags {
+
+namespace {
+
+// Fewer lines are not worth starting threads for.
+const size_t parallelSortThreshold = 64 * 1024;
+// Size of the chunks handed to the TagWriter.
+const size_t outputChunkSize = 1024 * 1024;
+
+template <typename T>
+struct LineLess {
+  SortOrder order;
+
+  explicit LineLess(SortOrder order) : order(order) {}
+  bool operator()(const T &a, const T &b) const
+  {
+    return compareTagLines(a.data, a.length, b.data, b.length, order) < 0;
+  }
+};
+
+template <typename T>
+struct SortTask {
+  pthread_t thread;
+  T *begin;
+  T *middle;    // NULL to sort rather than merge
+  T *end;
+  const LineLess<T> *less;
+};
+
+template <typename T>
+void *sortMain(void *data)
+{
+  SortTask<T> *task = static_cast<SortTask<T> *>(data);
+  if (task->middle == NULL) {
+    std::sort(task->begin, task->end, *task->less);
+  }
+  else {
+    std::inplace_merge(task->begin, task->middle, task->end, *task->less);
+  }
+  return NULL;
+}
+
+// Runs the tasks on their own threads, except for the first one.
+template <typename T>
+void runSortTasks(std::vector<SortTask<T> > &tasks)
+{
+  for (size_t i = 1; i < tasks.size(); i++) {
+    pthread_create(&tasks[i].thread, NULL, sortMain<T>, &tasks[i]);
+  }
+  sortMain<T>(&tasks[0]);
+  for (size_t i = 1; i < tasks.size(); i++) {
+    pthread_join(tasks[i].thread, NULL);
+  }
+}
+
+} // end namespace
+
+int compareTagLines(const char *a, size_t aLength, const char *b, size_t bLength, SortOrder order)
+{
+  size_t length = std::min(aLength, bLength);
+  if (order == sortorder_foldcase) {
+    // Folded to upper case, as Vim does when it searches the file.
+    for (size_t i = 0; i < length; i++) {
+      int ca = toupper(static_cast<unsigned char>(a[i]));
+      int cb = toupper(static_cast<unsigned char>(b[i]));
+      if (ca != cb) {
+        return ca - cb;
+      }
+    }
+    if (aLength != bLength) {
+      return (aLength < bLength) ? -1 : 1;
+    }
+  }
+  // Also breaks the ties of foldcase, so that the output is the same
+  // from run to run.
+  int result = memcmp(a, b, length);
+  if (result != 0) {
+    return result;
+  }
+  return (aLength < bLength) ? -1 : (aLength > bLength) ? 1 : 0;
+}
+
+TagSorter::TagSorter(SortOrder order, size_t memoryLimit, size_t threadCount) :
+  _order(order),
+  _memoryLimit(memoryLimit),
+  _threadCount(std::max(threadCount, static_cast<size_t>(1))),
+  _pendingSize(0),
+  _failed(false)
+{
+}
+
+TagSorter::~TagSorter()
+{
+  for (size_t i = 0; i < _runs.size(); i++) {
+    if (_runs[i] != NULL) {
+      fclose(_runs[i]);
+    }
+  }
+  for (size_t i = 0; i < _sortedReaders.size(); i++) {
+    delete _sortedReaders[i];
+  }
+}
+
+void TagSorter::addSorted(TagFileReader *reader)
+{
+  _sortedReaders.push_back(reader);
+}
+
+bool TagSorter::add(std::string &chunk)
+{
+  if (chunk.empty()) {
+    return !_failed;
+  }
+
+  _pendingSize += chunk.size();
+  _chunks.push_back(std::string());
+  _chunks.back().swap(chunk);
+
+  if (_memoryLimit > 0 && _pendingSize >= _memoryLimit) {
+    return _spill();
+  }
+  return !_failed;
+}
+
+// The lines are split in one range per thread, the ranges are sorted
+// side by side, then merged pairwise until one is left.
+void TagSorter::_sortLines(std::vector<Line> &lines) const
+{
+  LineLess<Line> less(_order);
+  if (_threadCount == 1 || lines.size() < parallelSortThreshold) {
+    std::sort(lines.begin(), lines.end(), less);
+    return;
+  }
+
+  std::vector<Line *> bounds;
+  for (size_t i = 0; i <= _threadCount; i++) {
+    bounds.push_back(&lines[0] + lines.size() * i / _threadCount);
+  }
+
+  std::vector<SortTask<Line> > tasks;
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    SortTask<Line> task;
+    task.begin = bounds[i];
+    task.middle = NULL;
+    task.end = bounds[i + 1];
+    task.less = &less;
+    tasks.push_back(task);
+  }
+  runSortTasks(tasks);
+
+  while (bounds.size() > 2) {
+    std::vector<Line *> merged;
+    tasks.clear();
+    for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+      merged.push_back(bounds[i]);
+      if (i + 2 < bounds.size()) {
+        SortTask<Line> task;
+        task.begin = bounds[i];
+        task.middle = bounds[i + 1];
+        task.end = bounds[i + 2];
+        task.less = &less;
+        tasks.push_back(task);
+      }
+    }
+    merged.push_back(bounds.back());
+    runSortTasks(tasks);
+    bounds.swap(merged);
+  }
+}
+
+bool TagSorter::_writePending(TagWriter &tagWriter)
+{
+  std::vector<Line> lines;
+  for (size_t i = 0; i < _chunks.size(); i++) {
+    const char *p = _chunks[i].data();
+    const char *end = p + _chunks[i].size();
+    while (p < end) {
+      const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+      if (newline == NULL) {
+        newline = end;
+      }
+      Line line;
+      line.data = p;
+      line.length = static_cast<uint32_t>(newline - p);
+      lines.push_back(line);
+      p = newline + 1;
+    }
+  }
+  _sortLines(lines);
+
+  std::string output;
+  for (size_t i = 0; i < lines.size(); i++) {
+    output.append(lines[i].data, lines[i].length);
+    output += '\n';
+    if (output.size() >= outputChunkSize) {
+      tagWriter.write(output);
+    }
+  }
+  _chunks.clear();
+  _pendingSize = 0;
+  return tagWriter.write(output);
+}
+
+bool TagSorter::_spill()
+{
+  FILE *run = tmpfile();
+  if (run == NULL) {
+    _failed = true;
+    return false;
+  }
+  _runs.push_back(run);
+
+  TagWriter runWriter;
+  runWriter.attach(fileno(run));
+  bool success = _writePending(runWriter);
+  success = runWriter.close() && success;
+  if (!success || fseek(run, 0, SEEK_SET) != 0) {
+    _failed = true;
+  }
+  return !_failed;
+}
+
+// Without spilled runs or sorted readers, the pending lines are sorted
+// and written.  Otherwise they are spilled as well, and all are merged.
+bool TagSorter::write(TagWriter &tagWriter)
+{
+  if (_runs.empty() && _sortedReaders.empty()) {
+    return !_failed && _writePending(tagWriter);
+  }
+  if (!_chunks.empty()) {
+    _spill();
+  }
+  if (_failed) {
+    return false;
+  }
+
+  TagMerger merger(_order);
+  for (size_t i = 0; i < _runs.size(); i++) {
+    TagFileReader *reader = new TagFileReader();
+    reader->attach(_runs[i]);
+    merger.add(reader);
+  }
+  for (size_t i = 0; i < _sortedReaders.size(); i++) {
+    merger.add(_sortedReaders[i]);
+  }
+  // The merger owns the files and readers now.
+  bool hasSortedReaders = !_sortedReaders.empty();
+  _runs.clear();
+  _sortedReaders.clear();
+
+  // Equal lines come out next to each other, and only the lines of the
+  // sorted readers can repeat those of the runs.
+  std::string output;
+  std::string line;
+  std::string last;
+  size_t run;
+  while (merger.next(line, run)) {
+    if (hasSortedReaders && line == last) {
+      continue;
+    }
+    last.swap(line);
+    output += last;
+    output += '\n';
+    if (output.size() >= outputChunkSize) {
+      tagWriter.write(output);
+    }
+  }
+
+  return tagWriter.write(output);
+}
+
+} // end namespace objctags
@@ -0,0 +1,93 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef __objctags_TagSorter_h__
+#define __objctags_TagSorter_h__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "TagFile.h"
+#include "TagWriter.h"
+
+namespace objctags {
+
+// The values of the '!_TAG_FILE_SORTED' pseudo-tag.
+enum SortOrder {
+  sortorder_none = 0,
+  sortorder_sorted = 1,
+  sortorder_foldcase = 2
+};
+
+// Compares whole tag lines, hence tag names first, in the given order.
+int compareTagLines(const char *a, size_t aLength, const char *b, size_t bLength, SortOrder order);
+
+/*
+ * Collects tag lines and writes them back in the order editors expect
+ * to binary-search them in: by bytes, or ignoring case as Vim does with
+ * 'ignorecase'.  Lines are sorted in memory by several threads.  Once
+ * more than memoryLimit bytes are pending, they are sorted and spilled
+ * to a temporary file, and the files are merged when written out.
+ */
+class TagSorter {
+public:
+  TagSorter(SortOrder order, size_t memoryLimit, size_t threadCount);
+  ~TagSorter();
+
+  // Takes over the contents of chunk, made of whole lines, leaving it
+  // empty.
+  bool add(std::string &chunk);
+  // Takes ownership of reader, whose lines are already in order, to be
+  // merged with the others as they are written.
+  void addSorted(TagFileReader *reader);
+  bool write(TagWriter &tagWriter);
+
+private:
+  struct Line {
+    const char *data;
+    uint32_t length;    // without the newline
+  };
+
+  SortOrder _order;
+  size_t _memoryLimit;
+  size_t _threadCount;
+  std::vector<std::string> _chunks;
+  size_t _pendingSize;
+  std::vector<FILE *> _runs;
+  std::vector<TagFileReader *> _sortedReaders;
+  bool _failed;
+
+  void _sortLines(std::vector<Line> &lines) const;
+  bool _writePending(TagWriter &tagWriter);
+  bool _spill();
+
+  TagSorter(const TagSorter &);
+  TagSorter &operator=(const TagSorter &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_TagSorter_h__ */
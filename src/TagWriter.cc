@@ -0,0 +1,170 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <algorithm>
+#include "TagWriter.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace objctags {
+
+namespace {
+
+// Pending bytes that trigger a flush.
+const size_t flushThreshold = 4 * 1024 * 1024;
+
+} // end namespace
+
+TagWriter::TagWriter() :
+  _fd(-1),
+  _ownsFd(false),
+  _failed(false),
+  _pendingSize(0)
+{
+}
+
+TagWriter::~TagWriter()
+{
+  close();
+}
+
+bool TagWriter::open(const std::string &fileName)
+{
+  close();
+
+  if (fileName == "-") {
+    _fd = STDOUT_FILENO;
+    _ownsFd = false;
+  }
+  else {
+    _fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    _ownsFd = true;
+  }
+
+  _failed = (_fd < 0);
+  return !_failed;
+}
+
+void TagWriter::attach(int fd)
+{
+  close();
+  _fd = fd;
+  _ownsFd = false;
+  _failed = (_fd < 0);
+}
+
+bool TagWriter::close()
+{
+  if (_fd < 0) {
+    return !_failed;
+  }
+
+  flush();
+  if (_ownsFd && ::close(_fd) != 0) {
+    _failed = true;
+  }
+  _fd = -1;
+  _ownsFd = false;
+
+  return !_failed;
+}
+
+bool TagWriter::write(std::string &chunk)
+{
+  if (chunk.empty()) {
+    return !_failed;
+  }
+
+  _pendingSize += chunk.size();
+  _pending.push_back(std::string());
+  _pending.back().swap(chunk);
+
+  if (_pendingSize >= flushThreshold) {
+    return flush();
+  }
+  return !_failed;
+}
+
+bool TagWriter::flush()
+{
+  if (!_pending.empty()) {
+    if (!_writeAll(_pending)) {
+      _failed = true;
+    }
+    _pending.clear();
+    _pendingSize = 0;
+  }
+  return !_failed;
+}
+
+bool TagWriter::_writeAll(const std::vector<std::string> &chunks)
+{
+  if (_fd < 0) {
+    return false;
+  }
+
+  std::vector<struct iovec> iov;
+  iov.reserve(chunks.size());
+  for (size_t i = 0; i < chunks.size(); i++) {
+    struct iovec v;
+    v.iov_base = const_cast<char *>(chunks[i].data());
+    v.iov_len = chunks[i].size();
+    iov.push_back(v);
+  }
+
+  size_t index = 0;
+  while (index < iov.size()) {
+    int count = static_cast<int>(std::min(iov.size() - index, static_cast<size_t>(IOV_MAX)));
+    ssize_t written = writev(_fd, &iov[index], count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+
+    // Skip the fully written vectors and trim a partially written one.
+    size_t remaining = static_cast<size_t>(written);
+    while (index < iov.size() && remaining >= iov[index].iov_len) {
+      remaining -= iov[index].iov_len;
+      index++;
+    }
+    if (remaining > 0) {
+      iov[index].iov_base = static_cast<char *>(iov[index].iov_base) + remaining;
+      iov[index].iov_len -= remaining;
+    }
+  }
+
+  return true;
+}
+
+} // end namespace objctags
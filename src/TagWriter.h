@@ -0,0 +1,68 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_TagWriter_h__
+#define __objctags_TagWriter_h__
+
+#include <string>
+#include <vector>
+
+namespace objctags {
+
+/*
+ * Streams formatted tag chunks to a file descriptor.  Chunks are kept
+ * only until a few megabytes are pending and are then flushed with a
+ * single writev(), so memory use does not grow with the output.
+ */
+class TagWriter {
+public:
+  TagWriter();
+  ~TagWriter();
+
+  // '-' writes to stdout.
+  bool open(const std::string &fileName);
+  // Writes to fd, which is not closed by close().
+  void attach(int fd);
+  bool close();
+
+  // Takes over the contents of chunk, leaving it empty.
+  bool write(std::string &chunk);
+  bool flush();
+
+private:
+  int _fd;
+  bool _ownsFd;
+  bool _failed;
+  size_t _pendingSize;
+  std::vector<std::string> _pending;
+
+  bool _writeAll(const std::vector<std::string> &chunks);
+
+  TagWriter(const TagWriter &);
+  TagWriter &operator=(const TagWriter &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_TagWriter_h__ */
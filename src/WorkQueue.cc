@@ -0,0 +1,89 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "WorkQueue.h"
+
+namespace objctags {
+
+WorkQueue::WorkQueue() :
+  _closed(false)
+{
+  pthread_mutex_init(&_mutex, NULL);
+  pthread_cond_init(&_cond, NULL);
+}
+
+WorkQueue::~WorkQueue()
+{
+  pthread_cond_destroy(&_cond);
+  pthread_mutex_destroy(&_mutex);
+}
+
+void WorkQueue::push(const std::string &fileName, double cost)
+{
+  Item item;
+  item.cost = cost;
+  item.fileName = fileName;
+
+  pthread_mutex_lock(&_mutex);
+  _items.push(item);
+  pthread_cond_signal(&_cond);
+  pthread_mutex_unlock(&_mutex);
+}
+
+void WorkQueue::close()
+{
+  pthread_mutex_lock(&_mutex);
+  _closed = true;
+  pthread_cond_broadcast(&_cond);
+  pthread_mutex_unlock(&_mutex);
+}
+
+void WorkQueue::clear()
+{
+  pthread_mutex_lock(&_mutex);
+  while (!_items.empty()) {
+    _items.pop();
+  }
+  pthread_mutex_unlock(&_mutex);
+}
+
+bool WorkQueue::pop(std::string &fileName)
+{
+  pthread_mutex_lock(&_mutex);
+  while (_items.empty() && !_closed) {
+    pthread_cond_wait(&_cond, &_mutex);
+  }
+
+  bool success = false;
+  if (!_items.empty()) {
+    fileName = _items.top().fileName;
+    _items.pop();
+    success = true;
+  }
+  pthread_mutex_unlock(&_mutex);
+
+  return success;
+}
+
+} // end namespace objctags
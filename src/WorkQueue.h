@@ -0,0 +1,77 @@
+/* vim: set ft=cpp fenc=utf-8 sw=2 ts=2 et: */
+/*
+ * Copyright (c) 2013 Chongyu Zhu <lembacon@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __objctags_WorkQueue_h__
+#define __objctags_WorkQueue_h__
+
+#include <pthread.h>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace objctags {
+
+/*
+ * A blocking queue of source files shared by all worker threads.
+ * Workers pop a file whenever they become idle, so the run is not
+ * bounded by the unluckiest static partition.  Files with the highest
+ * estimated cost are handed out first, leaving cheap files to fill
+ * the gaps at the end of the run.
+ */
+class WorkQueue {
+public:
+  WorkQueue();
+  ~WorkQueue();
+
+  void push(const std::string &fileName, double cost = 0);
+  void close();
+  // Drops the files that have not been handed out yet.
+  void clear();
+
+  // Returns false once the queue is closed and drained.
+  bool pop(std::string &fileName);
+
+private:
+  struct Item {
+    double cost;
+    std::string fileName;
+
+    bool operator<(const Item &item) const
+    {
+      return cost < item.cost;
+    }
+  };
+
+  pthread_mutex_t _mutex;
+  pthread_cond_t _cond;
+  std::priority_queue<Item> _items;
+  bool _closed;
+
+  WorkQueue(const WorkQueue &);
+  WorkQueue &operator=(const WorkQueue &);
+};
+
+} // end namespace objctags
+
+#endif /* __objctags_WorkQueue_h__ */
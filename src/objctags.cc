@@ -24,41 +24,150 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <strings.h>
 #include <dirent.h>
 #include <getopt.h>
+#include <fnmatch.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
 #include <pthread.h>
 #include <sstream>
 #include <fstream>
 #include <string>
 #include <vector>
+#include <set>
+#include <map>
+#include <llvm/ADT/OwningPtr.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/system_error.h>
 #include "Defines.h"
 #include "TagFormatter.h"
+#include "TagWriter.h"
 #include "Configuration.h"
+#include "DirectoryWalker.h"
 #include "ClangTool.h"
 #include "ClangFrontendAction.h"
+#include "WorkQueue.h"
+#include "CostModel.h"
+#include "ChunkQueue.h"
+#include "Manifest.h"
+#include "TagFile.h"
+#include "PrecompiledHeader.h"
+#include "StatCache.h"
+#include "TagDatabase.h"
+#include "FileWatcher.h"
+#include "TagServer.h"
+#include "TagSet.h"
+#include "TagSorter.h"
+#include "TagIndex.h"
+#include "TagMerger.h"
+#include "FastTagger.h"
 
 static int flag_recursive = 0;
+static int flag_incremental = 0;
+static int flag_no_prefix_header = 0;
+static int flag_daemon = 0;
+static int flag_index = 0;
+static int flag_update = 0;
+static int flag_append = 0;
+
+// Tags beyond this are sorted and spilled to disk, so that sorting does
+// not hold the whole output in memory.
+static size_t sortMemoryBytes = static_cast<size_t>(64) * 1024 * 1024;
 
 static struct option options[] = {
   { "file", required_argument, NULL, 'f' },
   { "recursive", no_argument, &flag_recursive, 1 },
   { "vim-conf", no_argument, NULL, 0 },
+  { "incremental", no_argument, &flag_incremental, 1 },
+  { "prefix-header", required_argument, NULL, 0 },
+  { "no-prefix-header", no_argument, &flag_no_prefix_header, 1 },
+  { "daemon", no_argument, &flag_daemon, 1 },
+  { "socket", required_argument, NULL, 0 },
+  { "fast", optional_argument, NULL, 0 },
+  { "time-limit", required_argument, NULL, 0 },
+  { "memory-limit", required_argument, NULL, 0 },
+  { "sort", optional_argument, NULL, 0 },
+  { "index", no_argument, &flag_index, 1 },
+  { "lookup", required_argument, NULL, 0 },
+  { "prefix", required_argument, NULL, 0 },
+  { "update", no_argument, &flag_update, 1 },
+  { "append", no_argument, &flag_append, 1 },
+  { "sort-memory", required_argument, NULL, 0 },
   { "version", no_argument, NULL, 'v' },
   { "help", no_argument, NULL, 'h' },
   { NULL, 0, NULL, 0 }
 };
 
+static struct option mergeOptions[] = {
+  { "sort", optional_argument, NULL, 0 },
+  { "replace", required_argument, NULL, 0 },
+  { "index", no_argument, &flag_index, 1 },
+  { "sort-memory", required_argument, NULL, 0 },
+  { NULL, 0, NULL, 0 }
+};
+
 static void usage(void)
 {
   std::ostringstream os;
   os << "Usage: " << OBJCTAGS_PROGRAM_NAME << " [options] [file(s)]\n";
+  os << "       " << OBJCTAGS_PROGRAM_NAME << " merge [--sort[=...]] [--sort-memory MB] [--replace LIST] [--index] [output] [input(s)]\n";
   os << "\n";
   os << "  -f, --file [FILE]  Output file. '-' for stdout.\n";
   os << "  -R, --recursive    Recursively search for source files\n";
   os << "      --vim-conf     Show vim conf for TagBar\n";
+  os << "      --incremental  Only re-parse files changed since the last run\n";
+  os << "      --prefix-header [FILE]\n";
+  os << "                     Prefix header implicitly included by every file\n";
+  os << "      --no-prefix-header\n";
+  os << "                     Do not look for or synthesize a prefix header\n";
+  os << "      --daemon       Keep running, re-tag files as they change and\n";
+  os << "                     answer queries on a socket\n";
+  os << "      --socket [FILE]\n";
+  os << "                     Socket of the daemon. Defaults to the output\n";
+  os << "                     file with '.sock' appended.\n";
+  os << "      --fast[=PATTERN]\n";
+  os << "                     Tag the files matching PATTERN, or all files,\n";
+  os << "                     from their tokens alone. Much faster, but less\n";
+  os << "                     accurate. Files that fail to parse always are.\n";
+  os << "      --time-limit [SECONDS]\n";
+  os << "                     Parse time after which a file is tagged from\n";
+  os << "                     its tokens instead. 0 for none. Defaults to 30.\n";
+  os << "      --memory-limit [MB]\n";
+  os << "                     Same for the AST memory of a file. 0 for none.\n";
+  os << "                     Defaults to 2048.\n";
+  os << "      --sort[=yes|no|foldcase]\n";
+  os << "                     Sort the tags by name, so that editors can\n";
+  os << "                     binary-search them, optionally ignoring case.\n";
+  os << "                     Defaults to yes.\n";
+  os << "      --sort-memory [MB]\n";
+  os << "                     Tags kept in memory while sorting, beyond which\n";
+  os << "                     they are sorted on disk. Defaults to 64.\n";
+  os << "      --index        Also write a binary index of the tags, next\n";
+  os << "                     to the output file with '.index' appended\n";
+  os << "      --lookup [NAME]\n";
+  os << "                     Print the tags named NAME from the index of\n";
+  os << "                     the output file, and exit\n";
+  os << "      --prefix [PREFIX]\n";
+  os << "                     Same for the tags whose name starts with PREFIX\n";
+  os << "      --update       Only tag the given files, and replace their\n";
+  os << "                     entries in the existing output file\n";
+  os << "      --append       Only tag the given files, and add their\n";
+  os << "                     entries to the existing output file\n";
   os << "  -v, --version      Show version\n";
   os << "  -h, --help         Show help\n";
+  os << "\n";
+  os << "merge combines tags files into output ('-' for stdout), writing\n";
+  os << "identical tags once.\n";
+  os << "\n";
+  os << "      --replace [LIST]\n";
+  os << "                     The files listed in LIST, one per line, were\n";
+  os << "                     re-tagged into the last input: their tags in\n";
+  os << "                     the other inputs are dropped\n";
   fprintf(stderr, "%s\n", os.str().c_str());
 }
 
@@ -72,44 +181,705 @@ static void vim_conf(void)
   printf("%s\n", objctags::tagbarConfigurations().c_str());
 }
 
+static objctags::SortOrder parseSortOrder(const char *value)
+{
+  if (value == NULL || strcmp(value, "yes") == 0) {
+    return objctags::sortorder_sorted;
+  }
+  else if (strcmp(value, "no") == 0) {
+    return objctags::sortorder_none;
+  }
+  else if (strcmp(value, "foldcase") == 0) {
+    return objctags::sortorder_foldcase;
+  }
+  fprintf(stderr, "'%s' is not a valid sort order\n", value);
+  exit(EXIT_FAILURE);
+}
+
+static size_t parseSortMemory(const char *value)
+{
+  char *end;
+  double megabytes = strtod(value, &end);
+  if (*value == '\0' || *end != '\0' || megabytes <= 0) {
+    fprintf(stderr, "'%s' is not a valid amount of memory\n", value);
+    exit(EXIT_FAILURE);
+  }
+  return static_cast<size_t>(megabytes * 1024 * 1024);
+}
+
+// The entry of the empty name, if any, is for the files without one of
+// their own, e.g. those found while the tagging is under way.
+typedef std::map<std::string, std::string> PrefixHeaderMap;
+
+static std::string findPrefixHeader(const std::string &sourceFile,
+                                    const PrefixHeaderMap &prefixHeaders)
+{
+  PrefixHeaderMap::const_iterator it = prefixHeaders.find(sourceFile);
+  if (it == prefixHeaders.end()) {
+    it = prefixHeaders.find("");
+  }
+  return (it != prefixHeaders.end()) ? it->second : "";
+}
+
+static objctags::Configuration getConfiguration(const std::string &sourceFile,
+                                                const PrefixHeaderMap &prefixHeaders)
+{
+  objctags::Configuration config;
+  //config.setSourceType(objctags::getSourceTypeForFileName(sourceFile));
+  config.setSourceType("objective-c++");
+
+  std::string prefixHeader = findPrefixHeader(sourceFile, prefixHeaders);
+  if (!prefixHeader.empty()) {
+    config.setPrefixHeader(prefixHeader);
+  }
+  return config;
+}
+
+typedef std::vector<std::string> PatternVector;
+
+static bool isFastFile(const std::string &sourceFile, const PatternVector &fastPatterns)
+{
+  for (size_t i = 0; i < fastPatterns.size(); i++) {
+    if (fnmatch(fastPatterns[i].c_str(), sourceFile.c_str(), 0) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// What the manifest records as the arguments of files tagged with
+// runFastTagger(), which takes none.
+static uint64_t getFastArgsHash(void)
+{
+  return objctags::hashArgs(std::vector<std::string>(1, "--fast"));
+}
+
 struct ThreadInfo {
   pthread_t thread;
-  pthread_mutex_t *tagFormatterMutex;
-  objctags::TagFormatter *tagFormatter;
-  std::vector<std::string> sourceFiles;
+  objctags::ChunkQueue *chunkQueue;
+  objctags::WorkQueue *workQueue;
+  objctags::CostModel *costModel;
+  objctags::Manifest *manifest;
+  objctags::PrecompiledHeaderCache *precompiledHeaders;
+  const PrefixHeaderMap *prefixHeaders;
+  const PatternVector *fastPatterns;
+  const objctags::ParseBudget *parseBudget;
+  objctags::StatCacheTable *statCache;
+  objctags::TagDatabase *database;
+  // Tags already written by any thread, unless the tags of every file
+  // are kept apart.
+  objctags::TagSet *tagSet;
+  // Unset when files may be rewritten while they are tagged, e.g. by an
+  // editor the daemon or --update runs alongside.
+  bool mapFiles;
+};
+
+// Hands the files found by a DirectoryWalker to the workers, and keeps a
+// list of them for the manifest.  The first ones are held back until the
+// walk is well ahead, so that the costliest of them still go first
+// rather than whichever the walk happens to reach first.  Only the large
+// files found after that can end up in the tail of the run.
+class SourceFileQueue : public objctags::DirectoryWalker::Listener {
+public:
+  SourceFileQueue(objctags::WorkQueue &workQueue, const objctags::CostModel &costModel,
+                  size_t headStart) :
+    _workQueue(workQueue),
+    _costModel(costModel),
+    _headStart(headStart),
+    _isHeld(headStart > 0)
+  {
+    pthread_mutex_init(&_mutex, NULL);
+  }
+
+  ~SourceFileQueue()
+  {
+    pthread_mutex_destroy(&_mutex);
+  }
+
+  virtual void foundSourceFile(const std::string &fileName)
+  {
+    std::vector<std::string> released;
+    pthread_mutex_lock(&_mutex);
+    _sourceFiles.insert(fileName);
+    bool isHeld = _isHeld;
+    if (isHeld) {
+      _heldFiles.push_back(fileName);
+      if (_heldFiles.size() >= _headStart) {
+        _isHeld = false;
+        released.swap(_heldFiles);
+      }
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (!isHeld) {
+      _workQueue.push(fileName, _costModel.estimate(fileName));
+    }
+    _push(released);
+  }
+
+  // Hands over the files still held back, once the walk is done.
+  void flush()
+  {
+    std::vector<std::string> released;
+    pthread_mutex_lock(&_mutex);
+    _isHeld = false;
+    released.swap(_heldFiles);
+    pthread_mutex_unlock(&_mutex);
+    _push(released);
+  }
+
+  const std::set<std::string> &getSourceFiles() const { return _sourceFiles; }
+
+private:
+  objctags::WorkQueue &_workQueue;
+  const objctags::CostModel &_costModel;
+  size_t _headStart;
+  pthread_mutex_t _mutex;
+  bool _isHeld;
+  std::vector<std::string> _heldFiles;
+  std::set<std::string> _sourceFiles;
+
+  void _push(const std::vector<std::string> &fileNames)
+  {
+    for (size_t i = 0; i < fileNames.size(); i++) {
+      _workQueue.push(fileNames[i], _costModel.estimate(fileNames[i]));
+    }
+  }
+};
+
+struct PreparedConfiguration {
+  // The prefix header and the headers it includes.
+  std::set<std::string> prefixInputs;
+  std::vector<std::string> args;
+  uint64_t argsHash;
 };
 
 static void *threadMain(void *data)
 {
   ThreadInfo *threadInfo = (ThreadInfo *)data;
-  for (size_t i = 0; i < threadInfo->sourceFiles.size(); i++) {
-    objctags::Configuration config;
-    //config.setSourceType(objctags::getSourceTypeForFileName(threadInfo->sourceFiles[i]));
-    config.setSourceType("objective-c++");
+  objctags::ClangTool clangTool(threadInfo->statCache);
+
+  // The configuration of a file only depends on its prefix header, so
+  // each distinct one is prepared once per thread.
+  std::map<std::string, PreparedConfiguration> configurations;
+  unsigned long precompiledHeaderGeneration = threadInfo->precompiledHeaders->getGeneration();
+
+  std::string sourceFile;
+  while (threadInfo->workQueue->pop(sourceFile)) {
+    // Prefix headers changed under a daemon, and the precompiled headers
+    // are being rebuilt.
+    if (threadInfo->precompiledHeaders->getGeneration() != precompiledHeaderGeneration) {
+      precompiledHeaderGeneration = threadInfo->precompiledHeaders->getGeneration();
+      configurations.clear();
+    }
+
+    // Tags of files removed while they were tagged are dropped.
+    unsigned long databaseGeneration = (threadInfo->database != NULL) ? threadInfo->database->getGeneration() : 0;
 
+    // Large files are mapped rather than read, unless they may be saved
+    // while being tagged, and the parser and the tags refer to the mapping
+    // directly.  Both rely on the null character that ends the buffer.
+    // The manifest records the state of what was read.
+    llvm::OwningPtr<llvm::MemoryBuffer> buffer;
+    objctags::FileState fileState;
+    if (!objctags::readSourceFile(sourceFile, threadInfo->mapFiles, buffer, fileState)) {
+      buffer.reset(llvm::MemoryBuffer::getMemBuffer("", sourceFile));
+      fileState.size = 0;
+      fileState.mtime = 0;
+      fileState.hash = objctags::hashBytes("", 0);
+    }
+    llvm::StringRef code = buffer->getBuffer();
+    double startTime = objctags::currentTime();
     objctags::TagInfoVector tagInfoVector;
-    objctags::runClangToolOnCodeWithArgs(new objctags::ClangFrontendAction(tagInfoVector),
-                                         objctags::readFile(threadInfo->sourceFiles[i]),
-                                         config.getClangArgs(),
-                                         threadInfo->sourceFiles[i]);
+    tagInfoVector.setSource(code.data(), code.size());
+    std::set<std::string> dependencies;
+    uint64_t argsHash;
+
+    if (isFastFile(sourceFile, *threadInfo->fastPatterns)) {
+      objctags::runFastTagger(code, sourceFile, tagInfoVector);
+      argsHash = getFastArgsHash();
+    }
+    else {
+      std::string key = findPrefixHeader(sourceFile, *threadInfo->prefixHeaders);
+      std::map<std::string, PreparedConfiguration>::iterator prepared = configurations.find(key);
+      if (prepared == configurations.end()) {
+        objctags::Configuration config = getConfiguration(sourceFile, *threadInfo->prefixHeaders);
+        PreparedConfiguration preparedConfig;
+        preparedConfig.argsHash = objctags::hashArgs(config.getClangArgs());
+        config.setPrecompiledHeader(threadInfo->precompiledHeaders->get(config, &preparedConfig.prefixInputs));
+        preparedConfig.args = config.getClangArgs();
+        prepared = configurations.insert(std::make_pair(key, preparedConfig)).first;
+      }
+      const PreparedConfiguration &config = prepared->second;
 
-    pthread_mutex_lock(threadInfo->tagFormatterMutex);
-    threadInfo->tagFormatter->merge(tagInfoVector);
-    pthread_mutex_unlock(threadInfo->tagFormatterMutex);
+      objctags::ParseBudget budget = *threadInfo->parseBudget;
+      bool success = clangTool.run(new objctags::ClangFrontendAction(tagInfoVector, &dependencies, &budget),
+                                   code,
+                                   config.args,
+                                   sourceFile);
+      if (budget.exceeded != objctags::parselimit_none) {
+        fprintf(stderr, "%s: over the %s limit after %.1fs, tagged from tokens\n",
+                sourceFile.c_str(),
+                budget.exceeded == objctags::parselimit_time ? "time" : "memory",
+                objctags::currentTime() - startTime);
+      }
+      if (budget.exceeded != objctags::parselimit_none) {
+        tagInfoVector.clear();
+        objctags::runFastTagger(code, sourceFile, tagInfoVector);
+      }
+      else if (tagInfoVector.empty() && (!success || clangTool.hasFatalError())) {
+        objctags::runFastTagger(code, sourceFile, tagInfoVector);
+        if (!tagInfoVector.empty()) {
+          fprintf(stderr, "%s: failed to parse, tagged from tokens\n", sourceFile.c_str());
+        }
+      }
+      // A missing header, e.g. of an SDK the workers were not given, is
+      // fatal, but the tags found up to there are kept.  Whatever the
+      // parser did not get to is left to the lexer.
+      else if (clangTool.hasFatalError()) {
+        objctags::TagInfoVector fastTagInfoVector;
+        fastTagInfoVector.setSource(code.data(), code.size());
+        objctags::runFastTagger(code, sourceFile, fastTagInfoVector);
+        if (tagInfoVector.append(fastTagInfoVector, tagInfoVector.getSourceEnd()) > 0) {
+          fprintf(stderr, "%s: stopped at a fatal error, tagged the rest from tokens\n", sourceFile.c_str());
+        }
+      }
+      // Headers loaded from the precompiled prefix are not seen by the
+      // preprocessor callbacks.
+      dependencies.insert(config.prefixInputs.begin(), config.prefixInputs.end());
+      argsHash = config.argsHash;
+    }
+
+    threadInfo->costModel->record(sourceFile, objctags::currentTime() - startTime);
+    threadInfo->manifest->update(sourceFile, fileState, argsHash, dependencies);
+
+    tagInfoVector.unique();
+    std::string chunk;
+    objctags::TagFormatter::format(tagInfoVector, chunk, threadInfo->tagSet);
+    if (threadInfo->database != NULL) {
+      threadInfo->database->update(sourceFile, chunk, databaseGeneration);
+    }
+    else if (!chunk.empty()) {
+      threadInfo->chunkQueue->push(chunk);
+    }
   }
   return NULL;
 }
 
+struct WriterInfo {
+  pthread_t thread;
+  objctags::ChunkQueue *chunkQueue;
+  objctags::TagWriter *tagWriter;
+  // If set, chunks are collected there to be sorted instead.
+  objctags::TagSorter *tagSorter;
+};
+
+static void *writerMain(void *data)
+{
+  WriterInfo *writerInfo = (WriterInfo *)data;
+  std::vector<std::string> chunks;
+  while (writerInfo->chunkQueue->popAll(chunks)) {
+    for (size_t i = 0; i < chunks.size(); i++) {
+      if (writerInfo->tagSorter != NULL) {
+        writerInfo->tagSorter->add(chunks[i]);
+      }
+      else {
+        writerInfo->tagWriter->write(chunks[i]);
+      }
+    }
+    chunks.clear();
+  }
+  return NULL;
+}
+
+static std::string getTempFileName(const std::string &tagFile)
+{
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".tmp.%ld", static_cast<long>(getpid()));
+  return tagFile + suffix;
+}
+
+static bool writeTagFile(const objctags::TagDatabase &database, const std::string &tagFile,
+                         objctags::SortOrder sortOrder)
+{
+  std::string tempFile = getTempFileName(tagFile);
+  objctags::TagWriter tagWriter;
+  if (!tagWriter.open(tempFile)) {
+    return false;
+  }
+
+  std::string header = objctags::TagFormatter::header(sortOrder);
+  tagWriter.write(header);
+  bool success;
+  if (sortOrder != objctags::sortorder_none) {
+    objctags::TagSorter tagSorter(sortOrder, sortMemoryBytes, sysconf(_SC_NPROCESSORS_ONLN));
+    success = database.write(tagSorter) && tagSorter.write(tagWriter);
+  }
+  else {
+    success = database.write(tagWriter);
+  }
+  success = tagWriter.close() && success;
+  if (!success || rename(tempFile.c_str(), tagFile.c_str()) != 0) {
+    unlink(tempFile.c_str());
+    return false;
+  }
+  if (flag_index && !objctags::writeTagIndex(tagFile, objctags::getIndexFileName(tagFile))) {
+    return false;
+  }
+  return true;
+}
+
+// Answers --lookup and --prefix from the index of tagFile.
+static int runQuery(const std::string &tagFile, const std::string &name, bool isPrefix)
+{
+  objctags::TagIndex index;
+  if (!index.open(objctags::getIndexFileName(tagFile))) {
+    fprintf(stderr, "cannot open the index of '%s', use --index to write one\n", tagFile.c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::string result;
+  size_t count = isPrefix ? index.lookupPrefix(name, result) : index.lookup(name, result);
+  fwrite(result.data(), 1, result.size(), stdout);
+  return (count > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static volatile sig_atomic_t flag_quit = 0;
+
+static void handleQuitSignal(int)
+{
+  flag_quit = 1;
+}
+
+// Queues the files affected by a batch of changes.
+static void handleChanges(const ThreadInfo &shared,
+                          const std::set<std::string> &changed,
+                          const std::set<std::string> &removed)
+{
+  std::set<std::string> sourceFiles;
+  for (std::set<std::string>::const_iterator it = changed.begin(); it != changed.end(); it++) {
+    if (!objctags::getSourceTypeForFileName(*it).empty()) {
+      sourceFiles.insert(*it);
+    }
+    shared.manifest->getDependents(*it, sourceFiles);
+  }
+  for (std::set<std::string>::const_iterator it = removed.begin(); it != removed.end(); it++) {
+    shared.database->remove(*it);
+    shared.manifest->getDependents(*it, sourceFiles);
+  }
+
+  // The precompiled headers that any of the files went into, whether as
+  // the prefix header or as a header it includes, are built again.
+  std::set<std::string> files(changed.begin(), changed.end());
+  files.insert(removed.begin(), removed.end());
+  shared.statCache->remove(files);
+  shared.precompiledHeaders->invalidate(files);
+
+  for (std::set<std::string>::const_iterator it = sourceFiles.begin(); it != sourceFiles.end(); it++) {
+    if (removed.find(*it) == removed.end()) {
+      shared.workQueue->push(*it, shared.costModel->estimate(*it));
+    }
+  }
+}
+
+// Keeps the tags of all files in memory, re-tags files as they change,
+// answers queries on socketPath, and rewrites tagFile (if any) whenever
+// things have settled down.
+static int runDaemon(const ThreadInfo &shared,
+                     const std::string &directory,
+                     const std::vector<std::string> &sourceFiles,
+                     const std::string &tagFile,
+                     objctags::SortOrder sortOrder,
+                     const std::string &socketPath)
+{
+  objctags::TagServer server;
+  if (!server.listen(socketPath)) {
+    fprintf(stderr, "cannot listen on '%s'\n", socketPath.c_str());
+    return EXIT_FAILURE;
+  }
+
+  // The tags file and everything written next to it change with every
+  // rewrite, which is no reason to re-tag anything.
+  objctags::FileWatcher watcher;
+  if (!tagFile.empty()) {
+    watcher.ignore(tagFile);
+  }
+  if (!socketPath.empty()) {
+    watcher.ignore(socketPath);
+  }
+  if (!directory.empty()) {
+    watcher.addDirectory(directory);
+  }
+  else {
+    for (size_t i = 0; i < sourceFiles.size(); i++) {
+      watcher.addFile(sourceFiles[i]);
+    }
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, handleQuitSignal);
+  signal(SIGTERM, handleQuitSignal);
+
+  size_t threadCount = sysconf(_SC_NPROCESSORS_ONLN);
+  ThreadInfo *threads = new ThreadInfo[threadCount];
+  for (size_t i = 0; i < threadCount; i++) {
+    threads[i] = shared;
+    pthread_create(&threads[i].thread, NULL, threadMain, &threads[i]);
+  }
+
+  const double pollInterval = 1.0;
+  const double settleInterval = 0.1;
+  double lastPoll = objctags::currentTime();
+  double lastChange = objctags::currentTime();
+  unsigned long lastGeneration = shared.database->getGeneration();
+  unsigned long writtenGeneration = 0;
+
+  while (!flag_quit) {
+    struct pollfd fds[2];
+    nfds_t nfds = 0;
+    fds[nfds].fd = server.getFileDescriptor();
+    fds[nfds].events = POLLIN;
+    fds[nfds].revents = 0;
+    nfds++;
+    if (watcher.getFileDescriptor() >= 0) {
+      fds[nfds].fd = watcher.getFileDescriptor();
+      fds[nfds].events = POLLIN;
+      fds[nfds].revents = 0;
+      nfds++;
+    }
+
+    int ready = poll(fds, nfds, 100);
+    if (ready < 0 && errno != EINTR) {
+      fprintf(stderr, "poll failed: %s\n", strerror(errno));
+      break;
+    }
+
+    if (ready > 0 && (fds[0].revents & POLLIN)) {
+      server.serve(*shared.database);
+    }
+
+    double now = objctags::currentTime();
+    bool watcherReady;
+    if (watcher.getFileDescriptor() >= 0) {
+      watcherReady = (ready > 0 && (fds[1].revents & POLLIN));
+    }
+    else {
+      watcherReady = (now - lastPoll >= pollInterval);
+    }
+    if (watcherReady) {
+      lastPoll = now;
+      std::set<std::string> changed;
+      std::set<std::string> removed;
+      watcher.readChanges(changed, removed);
+      if (!changed.empty() || !removed.empty()) {
+        handleChanges(shared, changed, removed);
+      }
+    }
+
+    unsigned long generation = shared.database->getGeneration();
+    if (generation != lastGeneration) {
+      lastGeneration = generation;
+      lastChange = now;
+    }
+    else if (!tagFile.empty() && generation != writtenGeneration && now - lastChange >= settleInterval) {
+      if (!writeTagFile(*shared.database, tagFile, sortOrder)) {
+        fprintf(stderr, "failed to write '%s'\n", tagFile.c_str());
+      }
+      writtenGeneration = generation;
+    }
+  }
+
+  shared.workQueue->clear();
+  shared.workQueue->close();
+  for (size_t i = 0; i < threadCount; i++) {
+    pthread_join(threads[i].thread, NULL);
+  }
+  delete[] threads;
+
+  if (!tagFile.empty()) {
+    if (shared.database->getGeneration() != writtenGeneration) {
+      writeTagFile(*shared.database, tagFile, sortOrder);
+    }
+    shared.costModel->save(objctags::getCostFileName(tagFile));
+    shared.manifest->save(objctags::getManifestFileName(tagFile));
+  }
+  return EXIT_SUCCESS;
+}
+
+// Inputs sorted like the output are merged as they are read, others go
+// through a TagSorter.  Tags equal to one already written are dropped;
+// those of sorted inputs only need to be remembered for one name at a
+// time.
+static int runMerge(int argc, char **argv)
+{
+  int ch;
+  int opt_index;
+  objctags::SortOrder sortOrder = objctags::sortorder_sorted;
+  std::string replaceList;
+
+  while ((ch = getopt_long(argc, argv, "", mergeOptions, &opt_index)) != -1) {
+    if (ch != 0) {
+      usage();
+      exit(EXIT_FAILURE);
+    }
+    if (opt_index == 0) {
+      sortOrder = parseSortOrder(optarg);
+    }
+    else if (opt_index == 1) {
+      replaceList = optarg;
+    }
+    else if (opt_index == 3) {
+      sortMemoryBytes = parseSortMemory(optarg);
+    }
+  }
+
+  argc -= optind;
+  argv += optind;
+  if (argc < 2) {
+    fprintf(stderr, "missing output or input files\n");
+    exit(EXIT_FAILURE);
+  }
+
+  std::string file = argv[0];
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; i++) {
+    inputs.push_back(objctags::expandPath(argv[i]));
+  }
+
+  std::string line;
+  size_t source;
+
+  // The files re-tagged into the last input, both as listed and expanded
+  // like the files the tags name.  Deleted files have no tags there, but
+  // theirs are dropped from the other inputs all the same.
+  std::set<std::string> replacedFiles;
+  if (!replaceList.empty()) {
+    std::ifstream stream(replaceList.c_str());
+    if (!stream) {
+      fprintf(stderr, "cannot open '%s'\n", replaceList.c_str());
+      exit(EXIT_FAILURE);
+    }
+    while (std::getline(stream, line)) {
+      if (!line.empty()) {
+        replacedFiles.insert(line);
+        replacedFiles.insert(objctags::expandPath(line));
+      }
+    }
+  }
+
+  objctags::TagMerger merger((sortOrder != objctags::sortorder_none) ? sortOrder : objctags::sortorder_sorted);
+  bool streaming = true;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    objctags::TagFileReader *reader = new objctags::TagFileReader();
+    if (!reader->open(inputs[i])) {
+      fprintf(stderr, "cannot open '%s'\n", inputs[i].c_str());
+      delete reader;
+      exit(EXIT_FAILURE);
+    }
+    merger.add(reader);
+    if (sortOrder != objctags::sortorder_none && reader->getSorted() != sortOrder) {
+      streaming = false;
+    }
+  }
+
+  std::string tagFile;
+  std::string tempFile = file;
+  if (file != "-") {
+    tagFile = objctags::expandPath(file);
+    tempFile = getTempFileName(tagFile);
+  }
+  else if (flag_index) {
+    fprintf(stderr, "the index requires an output file\n");
+    exit(EXIT_FAILURE);
+  }
+
+  objctags::TagWriter tagWriter;
+  if (!tagWriter.open(tempFile)) {
+    fprintf(stderr, "cannot open '%s' for writing\n", file.c_str());
+    exit(EXIT_FAILURE);
+  }
+  std::string header = objctags::TagFormatter::header(sortOrder);
+  tagWriter.write(header);
+
+  objctags::TagSorter tagSorter(sortOrder, sortMemoryBytes, sysconf(_SC_NPROCESSORS_ONLN));
+  objctags::TagSet tagSet;
+  std::set<std::string> group;
+  std::string groupName;
+  std::string chunk;
+  bool success = true;
+  while (merger.next(line, source)) {
+    if (!replacedFiles.empty() && source + 1 != inputs.size() &&
+        replacedFiles.count(objctags::getTagField(line, objctags::tagfield_file)) != 0) {
+      continue;
+    }
+
+    bool isNew;
+    if (streaming && sortOrder != objctags::sortorder_none) {
+      std::string name = objctags::getTagField(line, objctags::tagfield_name);
+      bool isSameName = (sortOrder == objctags::sortorder_foldcase) ?
+                        strcasecmp(name.c_str(), groupName.c_str()) == 0 : name == groupName;
+      if (!isSameName) {
+        group.clear();
+        groupName = name;
+      }
+      isNew = group.insert(line).second;
+    }
+    else {
+      isNew = tagSet.insert(line.data(), line.size());
+    }
+    if (!isNew) {
+      continue;
+    }
+
+    chunk += line;
+    chunk += '\n';
+    if (chunk.size() >= 1024 * 1024) {
+      success = (streaming ? tagWriter.write(chunk) : tagSorter.add(chunk)) && success;
+    }
+  }
+  success = (streaming ? tagWriter.write(chunk) : tagSorter.add(chunk)) && success;
+  if (!streaming) {
+    success = tagSorter.write(tagWriter) && success;
+  }
+  success = tagWriter.close() && success;
+
+  if (!success || (!tagFile.empty() && rename(tempFile.c_str(), tagFile.c_str()) != 0)) {
+    fprintf(stderr, "failed to write '%s'\n", file.c_str());
+    if (!tagFile.empty()) {
+      unlink(tempFile.c_str());
+    }
+    exit(EXIT_FAILURE);
+  }
+  if (flag_index && !objctags::writeTagIndex(tagFile, objctags::getIndexFileName(tagFile))) {
+    fprintf(stderr, "failed to write '%s'\n", objctags::getIndexFileName(tagFile).c_str());
+    exit(EXIT_FAILURE);
+  }
+  return EXIT_SUCCESS;
+}
+
 int main(int argc, char **argv)
 {
   int ch;
   int opt_index;
   std::string file = "tags";
+  std::string prefixHeader;
+  std::string socketPath;
+  PatternVector fastPatterns;
+  objctags::SortOrder sortOrder = objctags::sortorder_sorted;
+  std::string queryName;
+  bool hasQuery = false;
+  bool isPrefixQuery = false;
+  objctags::ParseBudget parseBudget;
+  parseBudget.seconds = 30;
+  parseBudget.memoryBytes = static_cast<size_t>(2048) * 1024 * 1024;
 
   if (argc == 1) {
     usage();
     exit(EXIT_SUCCESS);
   }
+  if (strcmp(argv[1], "merge") == 0) {
+    return runMerge(argc - 1, argv + 1);
+  }
 
   while ((ch = getopt_long(argc, argv, "f:rvh", options, &opt_index)) != -1) {
     switch (ch) {
@@ -118,6 +888,40 @@ int main(int argc, char **argv)
         vim_conf();
         exit(EXIT_SUCCESS);
       }
+      else if (opt_index == 4) {
+        prefixHeader = objctags::expandPath(optarg);
+      }
+      else if (opt_index == 7) {
+        socketPath = objctags::expandPath(optarg);
+      }
+      else if (opt_index == 8) {
+        fastPatterns.push_back(optarg != NULL ? optarg : "*");
+      }
+      else if (opt_index == 9 || opt_index == 10) {
+        char *end;
+        double value = strtod(optarg, &end);
+        if (*optarg == '\0' || *end != '\0' || value < 0) {
+          fprintf(stderr, "'%s' is not a valid limit\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        if (opt_index == 9) {
+          parseBudget.seconds = value;
+        }
+        else {
+          parseBudget.memoryBytes = static_cast<size_t>(value * 1024 * 1024);
+        }
+      }
+      else if (opt_index == 11) {
+        sortOrder = parseSortOrder(optarg);
+      }
+      else if (opt_index == 13 || opt_index == 14) {
+        queryName = optarg;
+        hasQuery = true;
+        isPrefixQuery = (opt_index == 14);
+      }
+      else if (opt_index == 17) {
+        sortMemoryBytes = parseSortMemory(optarg);
+      }
       break;
 
     case 'f':
@@ -148,7 +952,16 @@ int main(int argc, char **argv)
   argc -= optind;
   argv += optind;
 
+  if (hasQuery) {
+    if (file == "-") {
+      fprintf(stderr, "lookups require a tags file\n");
+      exit(EXIT_FAILURE);
+    }
+    return runQuery(objctags::expandPath(file), queryName, isPrefixQuery);
+  }
+
   std::vector<std::string> sourceFiles;
+  std::string searchDirectory;
 
   if (flag_recursive) {
     std::string directory;
@@ -169,7 +982,7 @@ int main(int argc, char **argv)
       closedir(dir);
     }
 
-    sourceFiles = objctags::recursivelySearchSourceFiles(expandedDir);
+    searchDirectory = expandedDir;
   }
   else {
     if (argc == 0) {
@@ -182,42 +995,321 @@ int main(int argc, char **argv)
     }
   }
 
-  objctags::TagFormatter tagFormatter;
-  pthread_mutex_t tagFormatterMutex;
-  pthread_mutex_init(&tagFormatterMutex, NULL);
+  std::string tagFile;
+  std::string tempFile = file;
+  if (file != "-") {
+    // Write next to the old tags file and rename when done, so the old
+    // file stays readable, both by editors and by incremental runs.
+    tagFile = objctags::expandPath(file);
+    tempFile = getTempFileName(tagFile);
+  }
+  else if (flag_incremental) {
+    fprintf(stderr, "incremental mode requires an output file\n");
+    exit(EXIT_FAILURE);
+  }
+  else if (flag_update || flag_append) {
+    fprintf(stderr, "--update and --append require an output file\n");
+    exit(EXIT_FAILURE);
+  }
+  else if (flag_index) {
+    fprintf(stderr, "the index requires an output file\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // The other entries of the tags file are kept as they are.
+  bool isPartial = flag_update || flag_append;
+  if (isPartial && (flag_incremental || flag_daemon)) {
+    fprintf(stderr, "--update and --append cannot be combined with --incremental or --daemon\n");
+    exit(EXIT_FAILURE);
+  }
+
+  // The given files, whose entries --update replaces.  Those that no
+  // longer exist are not tagged, so that their entries just go.
+  std::set<std::string> partialFiles;
+  if (isPartial) {
+    partialFiles.insert(sourceFiles.begin(), sourceFiles.end());
+    std::vector<std::string> existingFiles;
+    for (size_t i = 0; i < sourceFiles.size(); i++) {
+      if (access(sourceFiles[i].c_str(), F_OK) == 0) {
+        existingFiles.push_back(sourceFiles[i]);
+      }
+    }
+    sourceFiles.swap(existingFiles);
+  }
+
+  // When the prefix header of every file is known up front, the files are
+  // tagged as they are found.  Otherwise they are all needed first, for
+  // the common prefix header, or to tell which ones changed.
+  bool isStreaming = flag_recursive && !flag_daemon && !flag_incremental && !isPartial &&
+                     (flag_no_prefix_header || !prefixHeader.empty());
+  if (flag_recursive && !isStreaming) {
+    sourceFiles = objctags::recursivelySearchSourceFiles(searchDirectory);
+  }
+
+  if (flag_daemon && socketPath.empty()) {
+    if (tagFile.empty()) {
+      fprintf(stderr, "daemon mode requires an output file or a socket\n");
+      exit(EXIT_FAILURE);
+    }
+    socketPath = tagFile + ".sock";
+  }
+
+  objctags::CostModel costModel;
+  objctags::Manifest manifest;
+  if (!tagFile.empty()) {
+    costModel.load(objctags::getCostFileName(tagFile));
+    manifest.load(objctags::getManifestFileName(tagFile));
+    if (!isPartial && !isStreaming) {
+      manifest.retain(std::set<std::string>(sourceFiles.begin(), sourceFiles.end()));
+    }
+  }
+
+  // Files get a prefix header: the one given on the command line, the
+  // Xcode '*-Prefix.pch' of their target, or otherwise one made of the
+  // system includes that open most of the files, if they open with them.
+  PrefixHeaderMap prefixHeaders;
+  if (!flag_no_prefix_header && !prefixHeader.empty()) {
+    prefixHeaders[""] = prefixHeader;
+  }
+  else if (!flag_no_prefix_header) {
+    std::string commonPrefixHeader;
+    std::vector<std::string> commonIncludes;
+    if (!tagFile.empty()) {
+      // The few files of a partial run say little about the others, so
+      // the prefix header of the full run is kept if there is one.
+      std::string fileName = objctags::getPrefixHeaderFileName(tagFile);
+      if (isPartial) {
+        commonIncludes = objctags::readPrefixHeader(fileName);
+      }
+      else {
+        commonIncludes = objctags::findCommonSystemIncludes(sourceFiles);
+        if (!commonIncludes.empty() && !objctags::writePrefixHeader(fileName, commonIncludes)) {
+          commonIncludes.clear();
+        }
+      }
+      if (!commonIncludes.empty()) {
+        commonPrefixHeader = fileName;
+      }
+    }
+
+    std::map<std::string, std::string> xcodePrefixHeaders;
+    for (size_t i = 0; i < sourceFiles.size(); i++) {
+      std::string sourcePrefixHeader = objctags::findXcodePrefixHeader(sourceFiles[i], xcodePrefixHeaders);
+      // Unlike those of Xcode, the synthesized prefix header only goes
+      // where it would not change the meaning of the file.
+      if (sourcePrefixHeader.empty() && !commonPrefixHeader.empty() &&
+          objctags::startsWithIncludes(sourceFiles[i], commonIncludes)) {
+        sourcePrefixHeader = commonPrefixHeader;
+      }
+      if (!sourcePrefixHeader.empty()) {
+        prefixHeaders[sourceFiles[i]] = sourcePrefixHeader;
+      }
+    }
+  }
+  objctags::PrecompiledHeaderCache precompiledHeaders;
+  objctags::StatCacheTable statCache;
+
+  std::set<std::string> cleanFiles;
+  objctags::TagFileReader tagFileReader;
+  if (flag_incremental && tagFileReader.open(tagFile)) {
+    for (size_t i = 0; i < sourceFiles.size(); i++) {
+      uint64_t argsHash;
+      if (isFastFile(sourceFiles[i], fastPatterns)) {
+        argsHash = getFastArgsHash();
+      }
+      else {
+        argsHash = objctags::hashArgs(getConfiguration(sourceFiles[i], prefixHeaders).getClangArgs());
+      }
+      if (manifest.isClean(sourceFiles[i], argsHash)) {
+        cleanFiles.insert(sourceFiles[i]);
+      }
+    }
+  }
+
+  if (flag_daemon) {
+    // Start out with what the old tags file says about clean files.
+    objctags::TagDatabase database;
+    if (!cleanFiles.empty()) {
+      std::map<std::string, std::string> chunks;
+      std::string line;
+      while (tagFileReader.next(line)) {
+        std::string sourceFile = objctags::getTagField(line, objctags::tagfield_file);
+        if (cleanFiles.find(sourceFile) != cleanFiles.end()) {
+          std::string &chunk = chunks[sourceFile];
+          chunk += line;
+          chunk += "\n";
+        }
+      }
+      for (std::map<std::string, std::string>::iterator it = chunks.begin(); it != chunks.end(); it++) {
+        database.update(it->first, it->second, database.getGeneration());
+      }
+    }
+    tagFileReader.close();
+
+    objctags::WorkQueue workQueue;
+    for (size_t i = 0; i < sourceFiles.size(); i++) {
+      if (cleanFiles.find(sourceFiles[i]) == cleanFiles.end()) {
+        workQueue.push(sourceFiles[i], costModel.estimate(sourceFiles[i]));
+      }
+    }
+
+    ThreadInfo shared;
+    shared.chunkQueue = NULL;
+    shared.workQueue = &workQueue;
+    shared.costModel = &costModel;
+    shared.manifest = &manifest;
+    shared.precompiledHeaders = &precompiledHeaders;
+    shared.prefixHeaders = &prefixHeaders;
+    shared.fastPatterns = &fastPatterns;
+    shared.parseBudget = &parseBudget;
+    shared.statCache = &statCache;
+    shared.database = &database;
+    shared.tagSet = NULL;
+    shared.mapFiles = false;
+    return runDaemon(shared, searchDirectory, sourceFiles, tagFile, sortOrder, socketPath);
+  }
+
+  // The entries carried over from the old tags file: those of the clean
+  // files with --incremental, of the files not re-tagged with --update,
+  // and all of them with --append.
+  objctags::TagFileReader *oldTags = NULL;
+  if (!cleanFiles.empty() || isPartial) {
+    oldTags = new objctags::TagFileReader();
+    if (!oldTags->open(tagFile)) {
+      delete oldTags;
+      oldTags = NULL;
+    }
+    else if (flag_update) {
+      oldTags->setFileFilter(&partialFiles, false);
+    }
+    else if (!flag_append) {
+      oldTags->setFileFilter(&cleanFiles, true);
+    }
+  }
+  tagFileReader.close();
+  // If they are sorted like the output, they are merged in as the tags
+  // file is written, rather than sorted again.
+  bool mergeOldTags = (oldTags != NULL && sortOrder != objctags::sortorder_none && oldTags->getSorted() == sortOrder);
+
+  objctags::TagWriter tagWriter;
+  if (!tagWriter.open(tempFile)) {
+    fprintf(stderr, "cannot open '%s' for writing\n", file.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::string header = objctags::TagFormatter::header(sortOrder);
+  tagWriter.write(header);
 
   size_t threadCount = sysconf(_SC_NPROCESSORS_ONLN);
-  ThreadInfo *threads = new ThreadInfo[threadCount];
+  objctags::TagSorter tagSorter(sortOrder, sortMemoryBytes, threadCount);
+  objctags::ChunkQueue chunkQueue;
+  objctags::TagSet tagSet;
 
-  size_t perThreadSFCount = sourceFiles.size() / threadCount;
-  size_t remainingSFCount = sourceFiles.size() % threadCount;
+  objctags::WorkQueue workQueue;
+  for (size_t i = 0; i < sourceFiles.size(); i++) {
+    if (cleanFiles.find(sourceFiles[i]) == cleanFiles.end()) {
+      workQueue.push(sourceFiles[i], costModel.estimate(sourceFiles[i]));
+    }
+  }
+  if (!isStreaming) {
+    workQueue.close();
+  }
+
+  ThreadInfo *threads = new ThreadInfo[threadCount];
 
   for (size_t i = 0; i < threadCount; i++) {
-    threads[i].tagFormatterMutex = &tagFormatterMutex;
-    threads[i].tagFormatter = &tagFormatter;
-    std::vector<std::string>::iterator startIterator = sourceFiles.begin() + i * perThreadSFCount;
-    threads[i].sourceFiles.insert(threads[i].sourceFiles.begin(), startIterator, startIterator + perThreadSFCount);
-  }
-  for (size_t i = 0; i < remainingSFCount; i++) {
-    threads[i].sourceFiles.push_back(sourceFiles[sourceFiles.size() - remainingSFCount + i]);
+    threads[i].chunkQueue = &chunkQueue;
+    threads[i].workQueue = &workQueue;
+    threads[i].costModel = &costModel;
+    threads[i].manifest = &manifest;
+    threads[i].precompiledHeaders = &precompiledHeaders;
+    threads[i].prefixHeaders = &prefixHeaders;
+    threads[i].fastPatterns = &fastPatterns;
+    threads[i].parseBudget = &parseBudget;
+    threads[i].statCache = &statCache;
+    threads[i].database = NULL;
+    threads[i].tagSet = &tagSet;
+    threads[i].mapFiles = !isPartial;
   }
 
+  WriterInfo writer;
+  writer.chunkQueue = &chunkQueue;
+  writer.tagWriter = &tagWriter;
+  writer.tagSorter = (sortOrder != objctags::sortorder_none) ? &tagSorter : NULL;
+  pthread_create(&writer.thread, NULL, writerMain, &writer);
+
   for (size_t i = 0; i < threadCount; i++) {
     pthread_create(&threads[i].thread, NULL, threadMain, &threads[i]);
   }
+
+  if (isStreaming) {
+    // A few thousand files are found in a fraction of a second, and are
+    // enough for the costliest ones to be handed out first.
+    SourceFileQueue sourceFileQueue(workQueue, costModel, 4096);
+    objctags::DirectoryWalker walker(threadCount);
+    walker.walk(searchDirectory, sourceFileQueue);
+    sourceFileQueue.flush();
+    workQueue.close();
+    manifest.retain(sourceFileQueue.getSourceFiles());
+  }
+
+  // Unless the old entries are merged in at the end, they are carried
+  // over while the workers tag everything else.
+  if (oldTags != NULL && !mergeOldTags) {
+    std::string line;
+    std::string chunk;
+    while (oldTags->next(line)) {
+      if (tagSet.insert(line.data(), line.size())) {
+        chunk += line;
+        chunk += "\n";
+        if (chunk.size() >= 1024 * 1024) {
+          chunkQueue.push(chunk);
+        }
+      }
+    }
+    if (!chunk.empty()) {
+      chunkQueue.push(chunk);
+    }
+    delete oldTags;
+    oldTags = NULL;
+  }
+
   for (size_t i = 0; i < threadCount; i++) {
     pthread_join(threads[i].thread, NULL);
   }
-
-  pthread_mutex_destroy(&tagFormatterMutex);
   delete[] threads;
 
-  if (file == "-") {
-    printf("%s\n", tagFormatter.str().c_str());
+  chunkQueue.close();
+  pthread_join(writer.thread, NULL);
+
+  bool success = true;
+  if (writer.tagSorter != NULL) {
+    if (mergeOldTags) {
+      tagSorter.addSorted(oldTags);
+    }
+    success = tagSorter.write(tagWriter);
   }
-  else {
-    std::ofstream fs(objctags::expandPath(file).c_str());
-    fs << tagFormatter.str() << "\n";
+  success = tagWriter.close() && success;
+  if (!success) {
+    fprintf(stderr, "failed to write '%s'\n", file.c_str());
+    if (!tagFile.empty()) {
+      unlink(tempFile.c_str());
+    }
+    exit(EXIT_FAILURE);
+  }
+
+  if (!tagFile.empty()) {
+    if (rename(tempFile.c_str(), tagFile.c_str()) != 0) {
+      fprintf(stderr, "failed to write '%s'\n", file.c_str());
+      unlink(tempFile.c_str());
+      exit(EXIT_FAILURE);
+    }
+    if (flag_index && !objctags::writeTagIndex(tagFile, objctags::getIndexFileName(tagFile))) {
+      fprintf(stderr, "failed to write '%s'\n", objctags::getIndexFileName(tagFile).c_str());
+      exit(EXIT_FAILURE);
+    }
+    costModel.save(objctags::getCostFileName(tagFile));
+    manifest.save(objctags::getManifestFileName(tagFile));
   }
 
   return 0;